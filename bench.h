@@ -0,0 +1,948 @@
+//bench.h
+#pragma once
+#include "command.h"
+#include "timer.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <sstream>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// 时间轮自检：next_timeout不能跳过current_与now之间已经到期的定时器，也不能返回负数。
+// 返回false表示有检查失败
+inline bool test_timer_wheel() {
+    bool ok = true;
+    auto check = [&](const char* name, int actual, int expected) {
+        if (actual != expected) {
+            std::cout << "[时间轮] " << name << ": 期望 " << expected << "，实际 " << actual << std::endl;
+            ok = false;
+        }
+    };
+
+    // 处理一批事件期间到期的定时器：唤醒时应立即处理
+    TimerWheel overdue;
+    overdue.advance(100);
+    overdue.add(110, 0, []() {});
+    check("已到期", overdue.next_timeout(120), 0);
+    check("恰好到期", overdue.next_timeout(110), 0);
+    check("未到期", overdue.next_timeout(105), 5);
+
+    // current_在下放边界上、now已越过边界
+    TimerWheel cascade;
+    cascade.add(1000, 0, []() {});
+    cascade.advance(255);
+    check("下放已到期", cascade.next_timeout(260), 0);
+    check("下放远超", cascade.next_timeout(511), 0);
+
+    std::cout << "时间轮测试" << (ok ? "通过" : "失败") << std::endl;
+    return ok;
+}
+
+// 连接到本机端口，失败返回-1
+inline int bench_connect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    return fd;
+}
+
+// 读取直到收到count个'\n'，返回false表示连接断开；bytes累加读到的字节数
+inline bool bench_read_lines(int fd, int count, std::vector<char>& buffer, long long* bytes = nullptr) {
+    while (count > 0) {
+        ssize_t n = read(fd, buffer.data(), buffer.size());
+        if (n <= 0) return false;
+        if (bytes) *bytes += n;
+        for (ssize_t i = 0; i < n; i++) {
+            if (buffer[i] == '\n') count--;
+        }
+    }
+    return true;
+}
+
+// 读取直到收到count个二进制响应帧，pending保存读到的不完整帧
+inline bool bench_read_frames(int fd, int count, std::vector<char>& buffer,
+                              std::string& pending, long long* bytes = nullptr) {
+    while (true) {
+        size_t pos = 0;
+        while (count > 0 && pending.size() - pos >= BINARY_HEADER_SIZE) {
+            size_t frame = BINARY_HEADER_SIZE + get_u32(pending.data() + pos + 4);
+            if (pending.size() - pos < frame) break;
+            pos += frame;
+            count--;
+        }
+        pending.erase(0, pos);
+        if (count == 0) return true;
+
+        ssize_t n = read(fd, buffer.data(), buffer.size());
+        if (n <= 0) return false;
+        if (bytes) *bytes += n;
+        pending.append(buffer.data(), n);
+    }
+}
+
+// 客户端：每个连接一个线程，每轮流水线发送pipeline条命令再等待全部响应。
+// binary为true时command是二进制请求帧，连接后先发送BINARY_MAGIC；bytes_received返回收到的响应字节数
+inline long long bench_run_clients(int port, int connections, int pipeline, int seconds,
+                                   const std::string& command, bool binary = false,
+                                   long long* bytes_received = nullptr) {
+    std::atomic<long long> total_ops{0};
+    std::atomic<long long> total_bytes{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> clients;
+
+    std::string batch;
+    for (int i = 0; i < pipeline; i++) {
+        batch += command;
+    }
+
+    for (int c = 0; c < connections; c++) {
+        clients.emplace_back([&]() {
+            int fd = bench_connect(port);
+            if (fd < 0) return;
+
+            std::vector<char> buffer(64 * 1024);
+
+            // 欢迎信息以空行结尾
+            std::string welcome;
+            while (welcome.find("\n\n") == std::string::npos) {
+                ssize_t n = read(fd, buffer.data(), buffer.size());
+                if (n <= 0) { close(fd); return; }
+                welcome.append(buffer.data(), n);
+            }
+
+            if (binary) {
+                char magic = static_cast<char>(BINARY_MAGIC);
+                if (write(fd, &magic, 1) != 1) { close(fd); return; }
+            }
+
+            long long ops = 0;
+            long long bytes = 0;
+            std::string pending;
+            while (!stop) {
+                if (write(fd, batch.data(), batch.size()) != static_cast<ssize_t>(batch.size())) break;
+                bool ok = binary ? bench_read_frames(fd, pipeline, buffer, pending, &bytes)
+                                 : bench_read_lines(fd, pipeline, buffer, &bytes);
+                if (!ok) break;
+                ops += pipeline;
+            }
+            total_ops += ops;
+            total_bytes += bytes;
+            close(fd);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+    if (bytes_received) {
+        *bytes_received = total_bytes;
+    }
+    return total_ops;
+}
+
+// 为基准服务器创建连接处理器，默认为CommandHandler
+using BenchHandlerFactory =
+    std::function<std::unique_ptr<ConnectionHandler>(NetworkServer*, StorageEngine&)>;
+
+// 网络吞吐基准：在本进程内用指定事件循环启动服务器，返回每秒处理的命令数
+inline double bench_network(const std::string& loop_type, int connections = 16,
+                            int pipeline = 32, int seconds = 3, int port = 18899,
+                            const ServerOptions& options = ServerOptions(),
+                            const BenchHandlerFactory& factory = nullptr,
+                            bool binary = false, double* reply_bytes = nullptr) {
+    StorageEngine storage(1024, 1000, true);
+    storage.set("1001", User(1001, "bench", 1000));
+
+    NetworkServer server(EventLoop::create(loop_type), nullptr, options);
+    if (factory) {
+        server.set_handler(factory(&server, storage));
+    } else {
+        server.set_handler(std::make_unique<CommandHandler>(&server, storage));
+    }
+    if (!server.start("127.0.0.1", port)) {
+        return 0;
+    }
+
+    std::thread loop_thread([&server]() { server.run(); });
+
+    // 关闭连接日志，只测量网络与命令处理
+    LogLevel old_level = Logger::level();
+    Logger::set_level(LogLevel::WARN);
+
+    std::string command = "get/1001\n";
+    if (binary) {
+        command.clear();
+        append_binary_request(command, OP_GET, UserField::UNKNOWN, "1001", std::string_view());
+    }
+    long long bytes = 0;
+    long long ops = bench_run_clients(port, connections, pipeline, seconds, command, binary, &bytes);
+    if (reply_bytes) {
+        *reply_bytes = ops > 0 ? static_cast<double>(bytes) / ops : 0;
+    }
+
+    server.event_loop_->stop();
+    loop_thread.join();
+    Logger::set_level(old_level);
+
+    return static_cast<double>(ops) / seconds;
+}
+
+// 对比各事件循环的吞吐
+inline void bench_event_loops() {
+    const char* types[] = { "epoll", "epoll-et", "uring" };
+    int port = 18899;
+
+    std::cout << "网络吞吐基准: 16个连接, 每轮流水线32条get命令, 每种模型3秒\n";
+    for (const char* type : types) {
+        try {
+            double qps = bench_network(type, 16, 32, 3, port++);
+            std::cout << "  " << std::setw(10) << std::left << type
+                      << std::fixed << std::setprecision(0) << qps << " ops/s\n";
+        }
+        catch (const std::exception& e) {
+            std::cout << "  " << std::setw(10) << std::left << type << "不可用: " << e.what() << "\n";
+        }
+    }
+}
+
+// 对比命令在事件循环中执行与交给工作线程池执行的吞吐
+inline void bench_workers() {
+    int port = 18919;
+    int worker_counts[] = { 0, 1, 2, 4 };
+
+    std::cout << "工作线程基准: epoll, 16个连接, 每轮流水线32条get命令, 每种配置3秒\n";
+    for (int workers : worker_counts) {
+        ServerOptions options;
+        options.worker_threads = workers;
+        double qps = bench_network("epoll", 16, 32, 3, port++, options);
+        std::cout << "  workers=" << std::setw(3) << std::left << workers
+                  << std::fixed << std::setprecision(0) << qps << " ops/s\n";
+    }
+}
+
+// 原来的解析方式，作为解析基准的对照：拷贝整行、多趟erase去空白、istringstream按'/'切分
+inline std::vector<std::string> bench_legacy_parse(const char* data, size_t len) {
+    std::string command(data, len);
+    command.erase(std::remove(command.begin(), command.end(), '\n'), command.end());
+    command.erase(std::remove(command.begin(), command.end(), '\r'), command.end());
+    command.erase(0, command.find_first_not_of(' '));
+    command.erase(command.find_last_not_of(' ') + 1);
+
+    std::vector<std::string> tokens;
+    std::string token;
+    std::istringstream stream(command);
+    while (std::getline(stream, token, '/')) {
+        if (!token.empty()) {
+            tokens.push_back(token);
+        }
+    }
+    return tokens;
+}
+
+// 对比文本协议与二进制协议的GET吞吐和每个响应的字节数
+inline void bench_protocols() {
+    int port = 18969;
+
+    std::cout << "协议基准: epoll, 16个连接, 每轮流水线32条get命令, 每种协议3秒\n";
+    for (bool binary : { false, true }) {
+        double bytes = 0;
+        double qps = bench_network("epoll", 16, 32, 3, port++, ServerOptions(), nullptr, binary, &bytes);
+        std::cout << "  " << std::setw(8) << std::left << (binary ? "binary" : "text")
+                  << std::fixed << std::setprecision(0) << qps << " ops/s, "
+                  << std::setprecision(1) << bytes << " 字节/响应\n";
+    }
+}
+
+// 批量读取基准：多个线程各自反复读取同一组100个key，对比逐个get与一次get_many，输出每个key的耗时
+inline void bench_get_many() {
+    const int keys_per_batch = 100;
+    const int rounds = 20000;
+    StorageEngine storage(4096, 1000, true);
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < keys_per_batch; i++) {
+        keys.push_back(std::to_string(1000 + i));
+        storage.set(keys.back(), User(1000 + i, "bench", i));
+    }
+
+    std::cout << "批量读取基准: 每批" << keys_per_batch << "个key, 每线程" << rounds << "批\n";
+    for (int threads : { 1, 4 }) {
+        for (bool batched : { false, true }) {
+            std::atomic<size_t> sink{0};
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++) {
+                workers.emplace_back([&]() {
+                    size_t found = 0;
+                    for (int r = 0; r < rounds; r++) {
+                        if (batched) {
+                            for (const auto& result : storage.get_many(keys)) {
+                                found += result.first;
+                            }
+                        }
+                        else {
+                            for (const std::string& key : keys) {
+                                found += storage.get(key).first;
+                            }
+                        }
+                    }
+                    sink += found;
+                });
+            }
+            for (auto& w : workers) {
+                w.join();
+            }
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            double per_key = ns / (static_cast<double>(rounds) * keys_per_batch * threads);
+            std::cout << "  threads=" << threads << " " << std::setw(9) << std::left
+                      << (batched ? "get_many" : "get") << std::fixed << std::setprecision(1)
+                      << per_key << " ns/key (命中" << sink << ")\n";
+        }
+    }
+}
+
+// 存款基准：get后set（两次加锁、两次拷贝User）与add_cash（一次加锁原地修改），
+// 多线程向同一批key存款，输出每次存款的耗时和丢失的存款次数
+inline void bench_incr() {
+    const int num_keys = 16;
+    const int deposits = 200000;
+    std::cout << "存款基准: " << num_keys << "个key, 每线程" << deposits << "次存款\n";
+
+    for (int threads : { 1, 4 }) {
+        for (bool atomic_update : { false, true }) {
+            StorageEngine storage(4096, 1000, true);
+            std::vector<std::string> keys;
+            for (int i = 0; i < num_keys; i++) {
+                keys.push_back(std::to_string(1000 + i));
+                storage.set(keys.back(), User(1000 + i, "bench", 0));
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++) {
+                workers.emplace_back([&, t]() {
+                    long long balance = 0;
+                    for (int i = 0; i < deposits; i++) {
+                        const std::string& key = keys[(i + t) % num_keys];
+                        if (atomic_update) {
+                            storage.add_cash(key, 1, balance);
+                        }
+                        else {
+                            auto result = storage.get(key);
+                            result.second.cash += 1;
+                            storage.set(key, result.second);
+                        }
+                    }
+                });
+            }
+            for (auto& w : workers) {
+                w.join();
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            long long total = 0;
+            for (const auto& result : storage.get_many(keys)) {
+                total += result.second.cash;
+            }
+            long long expected = static_cast<long long>(deposits) * threads;
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            std::cout << "  threads=" << threads << " " << std::setw(9) << std::left
+                      << (atomic_update ? "add_cash" : "get+set") << std::fixed << std::setprecision(1)
+                      << ns / static_cast<double>(expected) << " ns/op, 丢失" << expected - total << "次存款\n";
+        }
+    }
+}
+
+// 存储引擎混合读写：threads个线程各执行ops_per_thread次操作，set_percent%为set，其余为get，
+// key随机取自keys；返回总吞吐量（次/秒），hits累加命中次数
+inline double bench_storage_mix(StorageEngine& storage, const std::vector<std::string>& keys,
+    int threads, int ops_per_thread, int set_percent, size_t& hits) {
+    std::atomic<size_t> sink{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            uint32_t rng = 2463534242u + static_cast<uint32_t>(t) * 7919u;
+            size_t found = 0;
+            for (int i = 0; i < ops_per_thread; i++) {
+                rng ^= rng << 13;
+                rng ^= rng >> 17;
+                rng ^= rng << 5;
+                const std::string& key = keys[rng % keys.size()];
+                if (static_cast<int>(rng % 100) < set_percent) {
+                    storage.set(key, User(static_cast<int>(rng % keys.size()), "bench", i));
+                }
+                else {
+                    found += storage.get(key).first;
+                }
+            }
+            sink += found;
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    hits = sink;
+    return static_cast<double>(ops_per_thread) * threads / seconds;
+}
+
+// 分片扩展性基准：单分片（全局一把锁）与默认分片数对比，1到32个线程各执行固定次数的操作
+// （95% get、5% set，key随机取自预先生成的key集合，LRU容量足够大不发生淘汰），输出总吞吐量
+inline void bench_storage_scaling() {
+    const int num_keys = 100000;
+    const int ops_per_thread = 200000;
+    std::vector<std::string> keys;
+    for (int i = 0; i < num_keys; i++) {
+        keys.push_back(std::to_string(100000 + i));
+    }
+
+    std::cout << "分片扩展性基准: " << num_keys << "个key, 95% get/5% set, 每线程" << ops_per_thread << "次操作"
+              << " (CPU核数: " << std::thread::hardware_concurrency() << ")\n";
+    for (int shards : { 1, StorageEngine::DEFAULT_SHARDS }) {
+        StorageEngine storage(num_keys * 2, num_keys * 2, true, shards);
+        for (int i = 0; i < num_keys; i++) {
+            storage.set(keys[i], User(100000 + i, "bench", i));
+        }
+
+        for (int threads : { 1, 2, 4, 8, 16, 32 }) {
+            size_t hits = 0;
+            double ops = bench_storage_mix(storage, keys, threads, ops_per_thread, 5, hits);
+            std::cout << "  shards=" << std::setw(3) << std::left << shards << "threads=" << std::setw(3) << threads
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(7) << ops / 1e6
+                      << " M ops/s (命中" << hits << ")\n";
+        }
+    }
+}
+
+// 淘汰策略读扩展性基准：严格LRU（读也要独占锁）与CLOCK（读只加共享锁），
+// 单分片和默认分片数下分别测100% get和95% get，缓存容量为key数的一半，读会有未命中
+inline void bench_eviction_policy() {
+    const int num_keys = 100000;
+    const int ops_per_thread = 200000;
+    std::vector<std::string> keys;
+    for (int i = 0; i < num_keys; i++) {
+        keys.push_back(std::to_string(100000 + i));
+    }
+
+    std::cout << "淘汰策略基准: " << num_keys << "个key, 缓存容量" << num_keys / 2 << ", 每线程" << ops_per_thread
+              << "次操作 (CPU核数: " << std::thread::hardware_concurrency() << ")\n";
+    for (int set_percent : { 0, 5 }) {
+        for (int shards : { 1, StorageEngine::DEFAULT_SHARDS }) {
+            for (EvictionPolicy policy : { EvictionPolicy::LRU, EvictionPolicy::CLOCK }) {
+                StorageEngine storage(num_keys * 2, num_keys / 2, true, shards, policy);
+                for (int i = 0; i < num_keys; i++) {
+                    storage.set(keys[i], User(100000 + i, "bench", i));
+                }
+
+                std::cout << "  " << 100 - set_percent << "% get shards=" << std::setw(3) << std::left << shards
+                          << std::setw(6) << (policy == EvictionPolicy::CLOCK ? "CLOCK" : "LRU") << std::right;
+                for (int threads : { 1, 2, 4, 8, 16, 32 }) {
+                    size_t hits = 0;
+                    double ops = bench_storage_mix(storage, keys, threads, ops_per_thread, set_percent, hits);
+                    std::cout << " t" << threads << "=" << std::fixed << std::setprecision(2) << ops / 1e6 << "M";
+                }
+                std::cout << " ops/s\n";
+            }
+        }
+    }
+}
+
+// 对一种哈希表计时：插入全部节点（从16个桶开始，包含扩容）、查找已有的key、查找不存在的key
+template<typename Table>
+inline void bench_hash_table(const char* name, const std::vector<DataNode*>& nodes,
+    const std::vector<size_t>& order, const std::vector<std::string>& missing) {
+    using clock = std::chrono::steady_clock;
+    auto ns_per = [](clock::duration d, size_t n) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()) / n;
+    };
+
+    Table table(16);
+    auto start = clock::now();
+    for (DataNode* node : nodes) {
+        table.insert(node);
+    }
+    double insert_ns = ns_per(clock::now() - start, nodes.size());
+
+    size_t found = 0;
+    start = clock::now();
+    for (size_t i : order) {
+        found += table.find(nodes[i]->key) != nullptr;
+    }
+    double hit_ns = ns_per(clock::now() - start, order.size());
+
+    start = clock::now();
+    for (const std::string& key : missing) {
+        found += table.find(key) != nullptr;
+    }
+    double miss_ns = ns_per(clock::now() - start, missing.size());
+
+    std::cout << "  " << std::setw(20) << std::left << name << std::right << std::fixed << std::setprecision(1)
+              << "插入 " << std::setw(6) << insert_ns << " ns  命中 " << std::setw(6) << hit_ns
+              << " ns  未命中 " << std::setw(6) << miss_ns << " ns  (找到" << found << ", 容量"
+              << table.get_capacity() << ")\n";
+    table.clear();
+}
+
+// 哈希表基准：链式的IntrusiveHashTable与开放寻址的SwissHashTable，1M和10M个key，查找各执行1M次。
+// 插入和查找都按随机顺序：连续的key在djb2下落到相邻的桶，顺序访问会让链式表显得过好
+inline void bench_hash_tables() {
+    const size_t lookups = 1000000;
+    for (size_t count : { static_cast<size_t>(1000000), static_cast<size_t>(10000000) }) {
+        std::vector<DataNode*> nodes;
+        nodes.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            nodes.push_back(new DataNode("user_" + std::to_string(i), User(static_cast<int>(i), "bench", 0)));
+        }
+
+        uint64_t rng = 88172645463325252ull;
+        for (size_t i = count - 1; i > 0; i--) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            std::swap(nodes[i], nodes[rng % (i + 1)]);
+        }
+
+        std::vector<size_t> order(lookups);
+        for (size_t& i : order) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            i = static_cast<size_t>(rng % count);
+        }
+        std::vector<std::string> missing;
+        missing.reserve(lookups);
+        for (size_t i = 0; i < lookups; i++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            missing.push_back("user_" + std::to_string(count + rng % count));
+        }
+
+        std::cout << "哈希表基准: " << count << "个key, 查找" << lookups << "次\n";
+        bench_hash_table<IntrusiveHashTable>("IntrusiveHashTable", nodes, order, missing);
+        bench_hash_table<SwissHashTable>("SwissHashTable", nodes, order, missing);
+
+        for (DataNode* node : nodes) {
+            delete node;
+        }
+    }
+}
+
+// 扩容停顿基准：向IntrusiveHashTable插入10M个key（从16个桶开始），记录每次insert的耗时。
+// 对比一次性rehash（rehash_step=0，原来的行为）、只在insert中渐进搬迁，以及服务器中的做法：
+// 每插入IDLE_BATCH个key调用一次rehash(IDLE_REHASH_STEP)模拟事件循环定时器在请求间隙搬迁（不计入insert耗时）
+inline void bench_rehash() {
+    const size_t count = 10000000;
+    const size_t IDLE_BATCH = 1000;
+    std::vector<DataNode*> nodes;
+    nodes.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        nodes.push_back(new DataNode("user_" + std::to_string(i), User(static_cast<int>(i), "bench", 0)));
+    }
+
+    struct Mode {
+        const char* name;
+        int step;
+        bool idle;
+    };
+    const Mode modes[] = {
+        { "一次性rehash", 0, false },
+        { "渐进式rehash", IntrusiveHashTable::DEFAULT_REHASH_STEP, false },
+        { "渐进式+空闲搬迁", IntrusiveHashTable::DEFAULT_REHASH_STEP, true },
+    };
+
+    std::cout << "扩容停顿基准: 插入" << count << "个key\n";
+    std::vector<uint32_t> latency(count);
+    for (const Mode& mode : modes) {
+        IntrusiveHashTable table(16);
+        table.set_rehash_step(mode.step);
+
+        double total_ms = 0;
+        auto last = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            if (mode.idle && i % IDLE_BATCH == 0) {
+                table.rehash(IntrusiveHashTable::IDLE_REHASH_STEP);
+                last = std::chrono::steady_clock::now();
+            }
+            table.insert(nodes[i]);
+            auto now = std::chrono::steady_clock::now();
+            latency[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+            total_ms += latency[i] / 1e6;
+            last = now;
+        }
+
+        std::vector<uint32_t> sorted(latency);
+        std::sort(sorted.begin(), sorted.end());
+        auto pct = [&](double p) { return sorted[static_cast<size_t>(p * (count - 1))]; };
+        std::cout << "  " << std::setw(16) << std::left << mode.name << std::right
+                  << " 总计" << std::fixed << std::setprecision(0) << total_ms << "ms  p50=" << pct(0.5)
+                  << "ns p99=" << pct(0.99) << "ns p99.9=" << pct(0.999) << "ns p99.99=" << pct(0.9999)
+                  << "ns max=" << std::setprecision(1) << sorted.back() / 1e6 << "ms\n";
+        table.clear();
+    }
+
+    for (DataNode* node : nodes) {
+        delete node;
+    }
+}
+
+// 原来IntrusiveHashTable的桶哈希：逐字节djb2，对容量取模
+inline unsigned int bench_legacy_djb2(const std::string& key, unsigned int cap) {
+    unsigned int hash = 5381;
+    for (char c : key) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash % cap;
+}
+
+// 一组key在cap个桶中的分布：空桶比例、各链长的桶占比、最长链，以及命中查找的平均比较次数
+template<typename Index>
+inline void bench_chain_lengths(const char* name, const std::vector<std::string>& keys, unsigned int cap, Index&& index) {
+    std::vector<uint32_t> chain(cap, 0);
+    for (const std::string& key : keys) {
+        chain[index(key)]++;
+    }
+
+    size_t histogram[5] = {};
+    uint32_t longest = 0;
+    double compares = 0;
+    for (uint32_t length : chain) {
+        histogram[length < 4 ? length : 4]++;
+        longest = std::max(longest, length);
+        compares += static_cast<double>(length) * (length + 1) / 2;
+    }
+
+    std::cout << "    " << std::setw(8) << std::left << name << std::right << std::fixed << std::setprecision(1);
+    for (int i = 0; i < 5; i++) {
+        std::cout << (i < 4 ? " 长度" : " 长度>=") << (i < 4 ? i : 4) << ":" << std::setw(5)
+                  << 100.0 * histogram[i] / cap << "%";
+    }
+    std::cout << "  最长" << longest << "  平均比较" << std::setprecision(2) << compares / keys.size() << "次\n";
+}
+
+// 哈希函数基准：原来的djb2取模与带种子的hash_key掩码，在顺序的user_N、数字ID和djb2碰撞构造的key上
+// 比较链长分布，再比较两种哈希的链式表查找耗时（原来的表只比较key，现在先比较缓存的哈希值）
+inline void bench_key_hash() {
+    struct KeySet {
+        const char* name;
+        std::vector<std::string> keys;
+        size_t lookups;
+    };
+    std::vector<KeySet> sets(3);
+    sets[0].name = "user_N";
+    sets[1].name = "数字ID";
+    sets[2].name = "djb2碰撞";
+    for (int i = 0; i < 1000000; i++) {
+        sets[0].keys.push_back("user_" + std::to_string(i));
+        sets[1].keys.push_back(std::to_string(100000 + i));
+    }
+    // "Ez"和"FY"的djb2增量相同，16段任意组合得到65536个djb2完全相同的key
+    for (int bits = 0; bits < (1 << 16); bits++) {
+        std::string key;
+        for (int i = 0; i < 16; i++) {
+            key += (bits >> i) & 1 ? "FY" : "Ez";
+        }
+        sets[2].keys.push_back(key);
+    }
+    sets[0].lookups = sets[1].lookups = 1000000;
+    sets[2].lookups = 2000;
+
+    for (KeySet& set : sets) {
+        size_t count = set.keys.size();
+        IntrusiveHashTable table(16);
+        std::vector<DataNode*> nodes;
+        for (const std::string& key : set.keys) {
+            nodes.push_back(new DataNode(key, User(0, "bench", 0)));
+            table.insert(nodes.back());
+        }
+        unsigned int cap = static_cast<unsigned int>(table.get_capacity());
+
+        std::cout << set.name << ": " << count << "个key, " << cap << "个桶\n";
+        bench_chain_lengths("djb2", set.keys, cap, [&](const std::string& key) { return bench_legacy_djb2(key, cap); });
+        bench_chain_lengths("hash_key", set.keys, cap,
+            [&](const std::string& key) { return static_cast<unsigned int>(hash_key(key) & (cap - 1)); });
+
+        std::vector<size_t> order(set.lookups);
+        uint64_t rng = 88172645463325252ull;
+        for (size_t& i : order) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            i = static_cast<size_t>(rng % count);
+        }
+
+        // 原来的表：按djb2重新挂链，查找时逐个比较key
+        std::vector<DataNode*> legacy(cap, nullptr);
+        std::vector<DataNode*> legacy_next(count, nullptr);
+        for (size_t i = 0; i < count; i++) {
+            unsigned int b = bench_legacy_djb2(nodes[i]->key, cap);
+            legacy_next[i] = legacy[b];
+            legacy[b] = nodes[i];
+            nodes[i]->hash_index = static_cast<int>(i);
+        }
+
+        size_t found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i : order) {
+            const std::string& key = set.keys[i];
+            for (DataNode* node = legacy[bench_legacy_djb2(key, cap)]; node; node = legacy_next[node->hash_index]) {
+                if (node->key == key) {
+                    found++;
+                    break;
+                }
+            }
+        }
+        double legacy_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i : order) {
+            found += table.find(set.keys[i]) != nullptr;
+        }
+        double table_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "    查找" << set.lookups << "次: djb2 " << std::setprecision(1) << legacy_ns / set.lookups
+                  << " ns, hash_key " << table_ns / set.lookups << " ns (找到" << found << ")\n";
+
+        table.clear();
+        for (DataNode* node : nodes) {
+            delete node;
+        }
+    }
+}
+
+// 命令解析微基准：原来的std::string/istringstream解析与string_view原地解析，输出每条命令的耗时
+inline void bench_parser() {
+    const char* commands[] = {
+        "get/1001",
+        "get//john \r",
+        "set/cash/1001/-500",
+        "set/name/john/John Doe",
+    };
+    const int iterations = 1000000;
+    size_t sink = 0;
+
+    std::cout << "命令解析基准: " << iterations << "轮, 每轮" << std::size(commands) << "条命令\n";
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (const char* command : commands) {
+            std::vector<std::string> tokens = bench_legacy_parse(command, strlen(command));
+            sink += tokens.size() + tokens.back().size();
+        }
+    }
+    auto legacy = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (const char* command : commands) {
+            ParsedCommand parsed = parse_command(std::string_view(command, strlen(command)));
+            sink += static_cast<size_t>(parsed.type) + parsed.key.size();
+        }
+    }
+    auto parsed = std::chrono::steady_clock::now() - start;
+
+    double ops = static_cast<double>(iterations) * std::size(commands);
+    auto ns_per_op = [ops](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / ops;
+    };
+    std::cout << std::fixed << std::setprecision(1)
+              << "  split/istringstream " << ns_per_op(legacy) << " ns/op\n"
+              << "  string_view         " << ns_per_op(parsed) << " ns/op\n"
+              << "  (校验值 " << sink << ")\n";
+}
+
+// GET回复格式化基准：原来的stringstream拼接后再拷贝进输出缓冲区，与to_chars/memcpy
+// 写入std::string、直接写入连接的OutputBuffer，输出每条回复的耗时
+inline void bench_reply_format() {
+    const int iterations = 2000000;
+    const int flush_every = 256;      // 模拟每轮事件处理结束时发送并清空输出缓冲区
+    User user(1001, "John Doe", -123456789);
+    user.email = "john@example.com";
+    user.phone = "13800138000";
+    size_t sink = 0;
+
+    std::cout << "GET回复格式化基准: " << iterations << "条回复\n";
+
+    OutputBuffer output;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        std::string reply;
+        std::stringstream ss;
+        ss << "data/" << user.id << "/" << user.name << "/" << user.email << "/"
+           << user.phone << "/" << user.cash << "\n";
+        reply += ss.str();
+        output.append(reply.data(), reply.size());
+        if (i % flush_every == 0) {
+            sink += output.size();
+            output.consume(output.size());
+        }
+    }
+    auto legacy = std::chrono::steady_clock::now() - start;
+
+    std::string reply;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        CommandHandler::append_user(user, reply);
+        if (i % flush_every == 0) {
+            sink += reply.size();
+            reply.clear();
+        }
+    }
+    auto to_string = std::chrono::steady_clock::now() - start;
+
+    output.consume(output.size());
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        CommandHandler::append_user(user, output);
+        if (i % flush_every == 0) {
+            sink += output.size();
+            output.consume(output.size());
+        }
+    }
+    auto to_output = std::chrono::steady_clock::now() - start;
+
+    auto ns_per_op = [iterations](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / static_cast<double>(iterations);
+    };
+    std::cout << std::fixed << std::setprecision(1)
+              << "  stringstream+拷贝      " << ns_per_op(legacy) << " ns/op\n"
+              << "  to_chars->std::string  " << ns_per_op(to_string) << " ns/op\n"
+              << "  to_chars->OutputBuffer " << ns_per_op(to_output) << " ns/op\n"
+              << "  (校验值 " << sink << ")\n";
+}
+
+// 延迟基准：单个连接逐条发送请求并等待响应，每两次请求之间空闲think_us微秒
+// （模拟请求稀疏、对延迟敏感的链路），按百分位输出往返时间
+inline void bench_latency(const std::string& loop_type, int busy_poll_us, int think_us,
+                          int seconds, int port) {
+    StorageEngine storage(1024, 1000, true);
+    storage.set("1001", User(1001, "bench", 1000));
+
+    ServerOptions options;
+    options.busy_poll_us = busy_poll_us;
+    NetworkServer server(EventLoop::create(loop_type), nullptr, options);
+    server.set_handler(std::make_unique<CommandHandler>(&server, storage));
+    if (!server.start("127.0.0.1", port)) {
+        return;
+    }
+
+    std::thread loop_thread([&server]() { server.run(); });
+
+    LogLevel old_level = Logger::level();
+    Logger::set_level(LogLevel::WARN);
+
+    std::vector<long long> samples;
+    int fd = bench_connect(port);
+    if (fd >= 0) {
+        std::vector<char> buffer(64 * 1024);
+        std::string welcome;
+        while (welcome.find("\n\n") == std::string::npos) {
+            ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n <= 0) break;
+            welcome.append(buffer.data(), n);
+        }
+
+        const std::string command = "get/1001\n";
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        while (std::chrono::steady_clock::now() < deadline) {
+            auto start = std::chrono::steady_clock::now();
+            if (write(fd, command.data(), command.size()) != static_cast<ssize_t>(command.size())) break;
+            if (!bench_read_lines(fd, 1, buffer)) break;
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            if (think_us > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(think_us));
+            }
+        }
+        close(fd);
+    }
+
+    server.event_loop_->stop();
+    loop_thread.join();
+    Logger::set_level(old_level);
+
+    if (samples.empty()) {
+        std::cout << "  busy_poll=" << busy_poll_us << "us 没有结果\n";
+        return;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t index = static_cast<size_t>(p * (samples.size() - 1));
+        return samples[index] / 1000.0;
+    };
+    BusyPollStats busy = server.event_loop_->busy_poll_stats();
+    std::cout << "  busy_poll=" << std::setw(5) << std::left << busy_poll_us
+              << std::fixed << std::setprecision(1)
+              << "p50=" << percentile(0.50) << "us, p99=" << percentile(0.99)
+              << "us, p99.9=" << percentile(0.999) << "us (" << samples.size() << "次请求)"
+              << ", 自旋命中=" << busy.spin_hits << ", 自旋超时=" << busy.spin_timeouts
+              << ", 阻塞等待=" << busy.blocking_waits << "\n";
+}
+
+// 对比不同忙轮询窗口下的请求延迟
+inline void bench_busy_poll() {
+    int port = 18959;
+    int windows[] = { 0, 50, 200, 1000 };
+
+    std::cout << "忙轮询延迟基准: epoll, 单连接逐条get, 请求间隔100us, 每种配置3秒\n";
+    for (int window : windows) {
+        bench_latency("epoll", window, 100, 3, port++);
+    }
+}
+
+#ifdef HAVE_COROUTINES
+// 对比回调式CommandHandler与协程会话（CoroCommandHandler）的吞吐
+inline void bench_coro() {
+    const char* types[] = { "epoll", "uring" };
+    int port = 18939;
+
+    BenchHandlerFactory coro = [](NetworkServer* server, StorageEngine& storage)
+        -> std::unique_ptr<ConnectionHandler> {
+        return std::make_unique<CoroCommandHandler>(server, storage);
+    };
+
+    std::cout << "协程基准: 16个连接, 每轮流水线32条get命令, 每种配置3秒\n";
+    for (const char* type : types) {
+        try {
+            double callback_qps = bench_network(type, 16, 32, 3, port++);
+            double coro_qps = bench_network(type, 16, 32, 3, port++, ServerOptions(), coro);
+            std::cout << "  " << std::setw(8) << std::left << type
+                      << "回调 " << std::fixed << std::setprecision(0) << callback_qps << " ops/s, "
+                      << "协程 " << coro_qps << " ops/s\n";
+        }
+        catch (const std::exception& e) {
+            std::cout << "  " << std::setw(8) << std::left << type << "不可用: " << e.what() << "\n";
+        }
+    }
+}
+#endif
@@ -0,0 +1,173 @@
+//binary_protocol.h
+#pragma once
+#include "command_parser.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// 二进制协议：客户端连接后发送的第一个字节为BINARY_MAGIC时，该连接后续使用二进制帧，
+// 否则按文本协议处理。服务器在连接建立时仍会发送文本欢迎信息（以空行"\n\n"结尾），
+// 二进制客户端读到空行后开始解析响应帧。整数都是网络字节序（大端）。
+//
+// 请求帧: | opcode u8 | field u8 | key_len u16 | value_len u32 | key | value |
+//   OP_GET: value_len为0
+//   OP_SET: field为UserField；name/email/phone的value为原始字节，cash的value为8字节有符号整数
+//
+// 响应帧: | status u8 | opcode u8 | reserved u16 | body_len u32 | body |
+//   GET成功: body为用户记录
+//            | id i32 | cash i64 | name_len u16 | name | email_len u16 | email | phone_len u16 | phone |
+//            字符串字段超过65535字节时返回STATUS_TOO_LARGE
+//   其他状态: body为错误信息（可以为空），与文本协议的提示相同，是GBK编码
+
+const uint8_t BINARY_MAGIC = 0xB5;   // 不是合法的ASCII/UTF-8首字节，不会与文本命令冲突
+
+const size_t BINARY_HEADER_SIZE = 8;
+const uint32_t BINARY_MAX_VALUE = 64 * 1024;  // 超过的帧视为错误，断开连接
+
+enum BinaryOpcode : uint8_t {
+    OP_GET = 1,
+    OP_SET = 2,
+};
+
+enum BinaryStatus : uint8_t {
+    STATUS_OK = 0,
+    STATUS_NOT_FOUND = 1,
+    STATUS_INVALID = 2,      // 请求参数错误（无效的ID、金额、字段、操作码）
+    STATUS_FAILED = 3,       // 存储失败
+    STATUS_TOO_LARGE = 4,    // 记录的字符串字段超过响应帧的u16长度，无法返回
+};
+
+struct BinaryRequest {
+    uint8_t opcode = 0;
+    UserField field = UserField::UNKNOWN;
+    std::string_view key;
+    std::string_view value;
+};
+
+inline void put_u16(std::string& out, uint16_t v) {
+    char bytes[2] = { static_cast<char>(v >> 8), static_cast<char>(v) };
+    out.append(bytes, 2);
+}
+
+inline void put_u32(std::string& out, uint32_t v) {
+    char bytes[4] = { static_cast<char>(v >> 24), static_cast<char>(v >> 16),
+                      static_cast<char>(v >> 8), static_cast<char>(v) };
+    out.append(bytes, 4);
+}
+
+inline void put_u64(std::string& out, uint64_t v) {
+    put_u32(out, static_cast<uint32_t>(v >> 32));
+    put_u32(out, static_cast<uint32_t>(v));
+}
+
+inline uint16_t get_u16(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint16_t>((b[0] << 8) | b[1]);
+}
+
+inline uint32_t get_u32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return (static_cast<uint32_t>(b[0]) << 24) | (static_cast<uint32_t>(b[1]) << 16) |
+           (static_cast<uint32_t>(b[2]) << 8) | b[3];
+}
+
+inline uint64_t get_u64(const char* p) {
+    return (static_cast<uint64_t>(get_u32(p)) << 32) | get_u32(p + 4);
+}
+
+// 帧解析结果
+enum class FrameStatus {
+    COMPLETE,
+    INCOMPLETE,   // 数据不够一帧，等待更多数据
+    TOO_LARGE     // 长度超出限制，协议错误
+};
+
+// 从data开头解析一个请求帧；COMPLETE时frame_size为整帧长度，request指向data内部
+inline FrameStatus parse_binary_request(const char* data, size_t len,
+                                        BinaryRequest& request, size_t& frame_size) {
+    if (len < BINARY_HEADER_SIZE) {
+        return FrameStatus::INCOMPLETE;
+    }
+    uint16_t key_len = get_u16(data + 2);
+    uint32_t value_len = get_u32(data + 4);
+    if (value_len > BINARY_MAX_VALUE) {
+        return FrameStatus::TOO_LARGE;
+    }
+
+    frame_size = BINARY_HEADER_SIZE + key_len + value_len;
+    if (len < frame_size) {
+        return FrameStatus::INCOMPLETE;
+    }
+
+    uint8_t field = static_cast<uint8_t>(data[1]);
+    request.opcode = static_cast<uint8_t>(data[0]);
+    request.field = field <= static_cast<uint8_t>(UserField::CASH)
+        ? static_cast<UserField>(field) : UserField::UNKNOWN;
+    request.key = std::string_view(data + BINARY_HEADER_SIZE, key_len);
+    request.value = std::string_view(data + BINARY_HEADER_SIZE + key_len, value_len);
+    return FrameStatus::COMPLETE;
+}
+
+// 返回data中完整帧的总长度；遇到超长帧时返回SIZE_MAX
+inline size_t complete_binary_frames(const char* data, size_t len) {
+    size_t consumed = 0;
+    BinaryRequest request;
+    size_t frame_size = 0;
+    while (true) {
+        FrameStatus status = parse_binary_request(data + consumed, len - consumed, request, frame_size);
+        if (status == FrameStatus::TOO_LARGE) {
+            return SIZE_MAX;
+        }
+        if (status == FrameStatus::INCOMPLETE) {
+            return consumed;
+        }
+        consumed += frame_size;
+    }
+}
+
+// 追加请求帧（客户端使用）
+inline void append_binary_request(std::string& out, uint8_t opcode, UserField field,
+                                  std::string_view key, std::string_view value) {
+    out.push_back(static_cast<char>(opcode));
+    out.push_back(static_cast<char>(field));
+    put_u16(out, static_cast<uint16_t>(key.size()));
+    put_u32(out, static_cast<uint32_t>(value.size()));
+    out.append(key.data(), key.size());
+    out.append(value.data(), value.size());
+}
+
+// 追加响应帧头，返回body_len字段的位置，body写完后用finish_binary_response回填
+inline size_t begin_binary_response(std::string& out, uint8_t status, uint8_t opcode) {
+    out.push_back(static_cast<char>(status));
+    out.push_back(static_cast<char>(opcode));
+    put_u16(out, 0);
+    size_t length_pos = out.size();
+    put_u32(out, 0);
+    return length_pos;
+}
+
+inline void finish_binary_response(std::string& out, size_t length_pos) {
+    uint32_t body_len = static_cast<uint32_t>(out.size() - length_pos - 4);
+    char bytes[4] = { static_cast<char>(body_len >> 24), static_cast<char>(body_len >> 16),
+                      static_cast<char>(body_len >> 8), static_cast<char>(body_len) };
+    memcpy(&out[length_pos], bytes, 4);
+}
+
+// 追加只带错误信息的响应
+inline void append_binary_status(std::string& out, uint8_t status, uint8_t opcode,
+                                 std::string_view message = std::string_view()) {
+    size_t length_pos = begin_binary_response(out, status, opcode);
+    out.append(message.data(), message.size());
+    finish_binary_response(out, length_pos);
+}
+
+// 追加带长度前缀的字符串字段；超过65535字节时不写入，返回false
+inline bool put_string16(std::string& out, std::string_view s) {
+    if (s.size() > 0xFFFF) {
+        return false;
+    }
+    put_u16(out, static_cast<uint16_t>(s.size()));
+    out.append(s.data(), s.size());
+    return true;
+}
@@ -0,0 +1,234 @@
+//buffer.h
+#pragma once
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// 连接输入缓冲区：连续存储已读取但尚未处理的数据，不完整的请求留到下次读取后继续处理
+class InputBuffer {
+private:
+    std::vector<char> data_;
+    size_t read_index_ = 0;     // 第一个未处理字节
+    size_t write_index_ = 0;    // 已读入数据的末尾
+
+public:
+    explicit InputBuffer(size_t initial_size = 4096) : data_(initial_size) {}
+
+    // 保证至少有n字节可写空间，优先把未处理数据挪到头部
+    void ensure_writable(size_t n) {
+        if (data_.size() - write_index_ >= n) return;
+
+        size_t readable = size();
+        if (read_index_ > 0) {
+            memmove(data_.data(), data_.data() + read_index_, readable);
+            read_index_ = 0;
+            write_index_ = readable;
+        }
+        if (data_.size() - write_index_ < n) {
+            size_t new_size = data_.size() * 2;
+            if (new_size < write_index_ + n) new_size = write_index_ + n;
+            data_.resize(new_size);
+        }
+    }
+
+    void append(const char* data, size_t len) {
+        ensure_writable(len);
+        memcpy(write_ptr(), data, len);
+        has_written(len);
+    }
+
+    char* write_ptr() { return data_.data() + write_index_; }
+    size_t writable() const { return data_.size() - write_index_; }
+    void has_written(size_t n) { write_index_ += n; }
+
+    const char* data() const { return data_.data() + read_index_; }
+    size_t size() const { return write_index_ - read_index_; }
+    bool empty() const { return size() == 0; }
+
+    // 丢弃已处理的n个字节
+    void consume(size_t n) {
+        read_index_ += n;
+        if (read_index_ >= write_index_) {
+            read_index_ = write_index_ = 0;
+        }
+    }
+
+    void clear() { read_index_ = write_index_ = 0; }
+};
+
+// 连接输出缓冲区：分块存储待发送数据，用writev一次性发送多个块
+class OutputBuffer {
+private:
+    static const size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+    static const int MAX_IOV = 64;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t start = 0;    // 第一个未发送字节
+        size_t end = 0;      // 已写入数据的末尾
+    };
+
+    std::deque<Block> blocks_;
+    Block spare_;            // 回收一个已发完的块，避免反复分配
+    size_t size_ = 0;
+
+    Block new_block(size_t min_size) {
+        if (spare_.data && spare_.capacity >= min_size) {
+            Block block = std::move(spare_);
+            block.start = block.end = 0;
+            spare_ = Block();
+            return block;
+        }
+
+        Block block;
+        block.capacity = min_size > DEFAULT_BLOCK_SIZE ? min_size : DEFAULT_BLOCK_SIZE;
+        block.data.reset(new char[block.capacity]);
+        return block;
+    }
+
+public:
+    OutputBuffer() = default;
+    OutputBuffer(OutputBuffer&&) = default;
+    OutputBuffer& operator=(OutputBuffer&&) = default;
+
+    // 追加数据
+    void append(const char* data, size_t len) {
+        if (len == 0) return;
+
+        if (!blocks_.empty()) {
+            Block& tail = blocks_.back();
+            size_t n = tail.capacity - tail.end;
+            if (n > len) n = len;
+            memcpy(tail.data.get() + tail.end, data, n);
+            tail.end += n;
+            size_ += n;
+            data += n;
+            len -= n;
+        }
+
+        if (len > 0) {
+            blocks_.push_back(new_block(len));
+            Block& tail = blocks_.back();
+            memcpy(tail.data.get(), data, len);
+            tail.end = len;
+            size_ += len;
+        }
+    }
+
+    OutputBuffer& operator+=(std::string_view data) {
+        append(data.data(), data.size());
+        return *this;
+    }
+
+    // 在尾部预留至少n字节的连续空间，返回写入位置；写完后用commit提交实际写入的字节数。
+    // 尾块放不下时开一个新块，尾块剩余的空间不再使用
+    char* reserve(size_t n) {
+        if (blocks_.empty() || blocks_.back().capacity - blocks_.back().end < n) {
+            blocks_.push_back(new_block(n));
+        }
+        Block& tail = blocks_.back();
+        return tail.data.get() + tail.end;
+    }
+
+    void commit(size_t n) {
+        blocks_.back().end += n;
+        size_ += n;
+    }
+
+    // 丢弃前n个字节（已发送）
+    void consume(size_t n) {
+        while (n > 0 && !blocks_.empty()) {
+            Block& head = blocks_.front();
+            size_t avail = head.end - head.start;
+            if (n < avail) {
+                head.start += n;
+                size_ -= n;
+                return;
+            }
+
+            n -= avail;
+            size_ -= avail;
+            if (!spare_.data || head.capacity > spare_.capacity) {
+                spare_ = std::move(head);
+            }
+            blocks_.pop_front();
+        }
+    }
+
+    // 填充iovec数组，返回使用的个数
+    int fill_iovec(iovec* iov, int max_iov) const {
+        int count = 0;
+        for (const Block& block : blocks_) {
+            if (count >= max_iov) break;
+            if (block.end == block.start) continue;
+            iov[count].iov_base = block.data.get() + block.start;
+            iov[count].iov_len = block.end - block.start;
+            count++;
+        }
+        return count;
+    }
+
+    // 用writev尽可能多地发送，返回发送的字节数；
+    // 返回-1表示出错（EAGAIN不算错误，返回已发送的字节数）
+    ssize_t write_to(int fd) {
+        ssize_t total = 0;
+
+        while (size_ > 0) {
+            iovec iov[MAX_IOV];
+            int count = fill_iovec(iov, MAX_IOV);
+
+            ssize_t n = writev(fd, iov, count);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return -1;
+            }
+
+            consume(static_cast<size_t>(n));
+            total += n;
+
+            // 没写完说明socket发送缓冲区已满
+            size_t requested = 0;
+            for (int i = 0; i < count; i++) requested += iov[i].iov_len;
+            if (static_cast<size_t>(n) < requested) break;
+        }
+
+        return total;
+    }
+
+    void clear() {
+        blocks_.clear();
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+};
+
+// 回复的格式化函数通过这两个函数直接写入目标缓冲区，std::string（工作线程、协程）
+// 和连接的OutputBuffer（事件循环线程）都可以作为回复目标。
+// reply_reserve预留n字节，reply_commit提交其中实际写入的used字节
+inline char* reply_reserve(std::string& out, size_t n) {
+    size_t old = out.size();
+    out.resize(old + n);
+    return &out[old];
+}
+
+inline void reply_commit(std::string& out, size_t reserved, size_t used) {
+    out.resize(out.size() - reserved + used);
+}
+
+inline char* reply_reserve(OutputBuffer& out, size_t n) {
+    return out.reserve(n);
+}
+
+inline void reply_commit(OutputBuffer& out, size_t, size_t used) {
+    out.commit(used);
+}
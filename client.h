@@ -1,13 +1,26 @@
 //client.h
 #pragma once
 #include "network.h"
+#include "uring_loop.h"
+#include "buffer.h"
+#include "worker_pool.h"
+#include "logger.h"
 #include <stdexcept>
+#include <climits>
 
 std::unique_ptr<EventLoop> EventLoop::create(const std::string& type) {
     if (type == "poll") {
         return std::make_unique<PollLoop>();
     } else if (type == "epoll") {
         return std::make_unique<EpollLoop>();
+    } else if (type == "epoll-et") {
+        return std::make_unique<EpollLoop>(true);
+    } else if (type == "uring") {
+#ifdef HAVE_IO_URING
+        return std::make_unique<UringLoop>();
+#else
+        throw std::runtime_error("io_uring is not available on this platform");
+#endif
     } else {
         throw std::runtime_error("Unknown event loop type: " + type);
     }
@@ -19,15 +32,69 @@ std::unique_ptr<EventLoop> EventLoop::create(const std::string& type) {
 #include <unordered_map>
 #include <netinet/in.h>
 #include <fcntl.h>
-#include <iostream>
 #include <arpa/inet.h>
+#include <thread>
+#include <vector>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+
+// 服务器选项
+struct ServerOptions {
+    bool reuse_port = false;    // 设置SO_REUSEPORT，允许多个监听socket绑定同一端口
+    size_t output_high_water = 4 * 1024 * 1024;  // 输出积压超过该值时暂停读取该连接（0为不限制）
+    size_t max_input_buffer = 1024 * 1024;       // 单个连接未处理数据的上限，超过视为异常请求并断开
+    int idle_timeout_ms = 300 * 1000;  // 连接空闲（无收发）超过该时间后断开（0为不限制）
+    int stats_interval_ms = 0;         // 定期输出统计信息的间隔（0为不输出）
+    int worker_threads = 0;            // >0时命令交给工作线程池执行，事件循环只负责I/O和分帧
+    int backlog = SOMAXCONN;           // listen队列长度（实际值还受net.core.somaxconn限制）
+    int max_accept_per_event = 64;     // 每次监听socket就绪时最多accept的连接数，避免accept饿死读事件
+    bool tcp_nodelay = false;          // 对接受的连接关闭Nagle算法
+    int defer_accept_sec = 0;          // >0时设置TCP_DEFER_ACCEPT：客户端发来数据后才完成accept。
+                                       // 本服务器在连接建立时先发欢迎信息，只适合不等欢迎信息就发请求的客户端
+    int busy_poll_us = 0;              // >0时事件循环处理完事件后自旋该时间再睡眠（目前只有epoll支持）
+    int so_busy_poll_us = 0;           // >0时对接受的连接设置SO_BUSY_POLL，读socket时在网卡队列上忙等；
+                                       // 超过net.core.busy_read的值需要CAP_NET_ADMIN
+};
+
+// 服务器统计，只在事件循环线程中修改
+struct ServerStats {
+    uint64_t accepted = 0;      // 累计接受的连接
+    uint64_t closed = 0;        // 累计关闭的连接
+    uint64_t idle_closed = 0;   // 其中因空闲超时关闭的连接
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+};
 
 // TCP服务器
 class NetworkServer {
 public:
     std::unique_ptr<EventLoop> event_loop_;
     std::unique_ptr<ConnectionHandler> conn_handler_;
+    ServerOptions options_;
+    ServerStats stats_;
     int server_fd_{-1};
+    TimerId stats_timer_ = 0;
+    bool busy_poll_warned_ = false;    // SO_BUSY_POLL设置失败只提示一次
+    
+    // 工作线程池：own_workers_为本服务器独占的池，多reactor时由MultiReactorServer共享一个池
+    std::unique_ptr<WorkerPool> own_workers_;
+    WorkerPool* workers_ = nullptr;
+    
+    // 工作线程的执行结果，经eventfd唤醒后由事件循环线程写入连接
+    struct Reply {
+        int fd = -1;
+        uint64_t conn_id = 0;
+        std::string data;
+    };
+    MpscQueue<Reply> replies_;
+    std::atomic<bool> reply_wakeup_pending_{false};
+    int reply_fd_{-1};
+    uint64_t next_conn_id_ = 0;
+    
+    // 因工作线程队列满而暂停的连接，取回回复时或定时器到期时重新处理它们的输入
+    std::vector<int> offload_blocked_;
+    TimerId offload_retry_timer_ = 0;
     
     // 内部事件处理器
     class ServerEventHandler : public EventHandler {
@@ -44,6 +111,27 @@ public:
         void handle_event(int fd, EventType events) override {
             server_->handle_server_event(fd, events);
         }
+        
+        void handle_accept(int client_fd, const sockaddr_in& addr) override {
+            server_->handle_accepted(client_fd, addr);
+        }
+    };
+    
+    // 工作线程回复通知
+    class ReplyEventHandler : public EventHandler {
+    private:
+        NetworkServer* server_;
+        int fd_;
+        
+    public:
+        ReplyEventHandler(NetworkServer* server, int fd) 
+            : server_(server), fd_(fd) {}
+        
+        int get_fd() const override { return fd_; }
+        
+        void handle_event(int /*fd*/, EventType /*events*/) override {
+            server_->handle_replies();
+        }
     };
     
     class ClientEventHandler : public EventHandler {
@@ -52,95 +140,645 @@ public:
         int fd_;
         
     public:
+        InputBuffer input;                     // 已读取但未组成完整请求的数据
+        OutputBuffer output;                   // 尚未发送的数据
+        EventType interest = EventType::READ;  // 当前在事件循环中注册的事件
+        bool read_paused = false;              // 输出积压超过高水位，暂停读取
+        bool flush_pending = false;            // 已加入本轮待刷新列表
+        bool send_inflight = false;            // 完成式事件循环中有未完成的发送
+        bool closed = false;                   // 连接已关闭，等待发送完成后释放
+        bool close_after_drain = false;        // 不再读取，输出发送完后关闭
+        size_t offloaded = 0;                  // 交给工作线程、回复尚未取回的任务数
+        bool offload_blocked = false;          // 工作线程队列满，请求留在输入缓冲区，暂停读取等待重试
+        uint64_t last_active = 0;              // 最后一次收发数据的时间（事件循环时间）
+        TimerId idle_timer = 0;                // 空闲检查定时器
+        uint64_t bytes_in = 0;                 // 本连接累计接收的字节数
+        uint64_t bytes_out = 0;                // 本连接累计发送的字节数
+        uint64_t id = 0;                       // 连接编号，fd复用后不同，用于丢弃发给旧连接的回复
+        
         ClientEventHandler(NetworkServer* server, int fd) 
             : server_(server), fd_(fd) {}
         
         int get_fd() const override { return fd_; }
         
-        void handle_event(int fd, EventType events) override {
-            server_->handle_client_event(fd, events);
+        // 复用对象承载新连接，缓冲区保留已分配的内存
+        void reset(int fd) {
+            fd_ = fd;
+            input.clear();
+            output.clear();
+            interest = EventType::READ;
+            read_paused = false;
+            flush_pending = false;
+            send_inflight = false;
+            closed = false;
+            close_after_drain = false;
+            offloaded = 0;
+            offload_blocked = false;
+            last_active = 0;
+            idle_timer = 0;
+            bytes_in = 0;
+            bytes_out = 0;
+        }
+        
+        void handle_event(int /*fd*/, EventType events) override {
+            if (!closed) {
+                server_->handle_client_event(this, events);
+            }
+        }
+        
+        void handle_recv(int /*fd*/, const char* data, ssize_t len) override {
+            server_->handle_client_recv(this, data, len);
+        }
+        
+        void handle_send(int /*fd*/, ssize_t len) override {
+            server_->handle_client_send(this, len);
         }
     };
     
     std::unique_ptr<ServerEventHandler> server_handler_;
-    std::unordered_map<int, std::unique_ptr<ClientEventHandler>> client_handlers_;
+    std::unique_ptr<ReplyEventHandler> reply_handler_;
+    
+    // 连接表：按fd索引，连接关闭后对象留在原位（closed为true），fd被复用时直接重置复用
+    std::vector<std::unique_ptr<ClientEventHandler>> connections_;
+    size_t active_connections_ = 0;
+    
+    // 已关闭但内核仍在发送其输出缓冲区的连接（仅完成式事件循环）
+    std::vector<std::unique_ptr<ClientEventHandler>> closing_handlers_;
+    
+    // 发送完成后回收的连接对象，供新连接复用
+    std::vector<std::unique_ptr<ClientEventHandler>> free_handlers_;
+    
+    // 查找fd对应的活动连接
+    ClientEventHandler* find_connection(int fd) const {
+        if (fd < 0 || static_cast<size_t>(fd) >= connections_.size()) {
+            return nullptr;
+        }
+        ClientEventHandler* conn = connections_[fd].get();
+        return (conn && !conn->closed) ? conn : nullptr;
+    }
+    
+    // 本轮事件处理中产生了输出的连接，处理结束后统一刷新
+    std::vector<int> pending_flush_;
+    bool dispatching_ = false;
     
     void handle_server_event(int fd, EventType events) {
         if (fd != server_fd_) return;
         
         if (static_cast<int>(events) & static_cast<int>(EventType::READ)) {
-            accept_connection();
+            accept_batch();
         }
     }
     
-    void handle_client_event(int fd, EventType events) {
-        if (static_cast<int>(events) & static_cast<int>(EventType::READ)) {
-            char buffer[4096];
-            ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+    // 循环accept直到EAGAIN，但每次最多max_accept_per_event个。水平触发下剩余的连接
+    // 会在下一轮再次通知；边缘触发不会，所以交给queue_in_loop在本轮其他事件之后继续
+    void accept_batch() {
+        int limit = options_.max_accept_per_event > 0 ? options_.max_accept_per_event : INT_MAX;
+        int accepted = 0;
+        
+        dispatching_ = true;
+        while (accepted < limit && accept_connection()) {
+            accepted++;
+        }
+        dispatching_ = false;
+        flush_pending();
+        
+        if (accepted == limit && event_loop_->edge_triggered() && server_fd_ >= 0) {
+            event_loop_->queue_in_loop([this]() {
+                if (server_fd_ >= 0) {
+                    accept_batch();
+                }
+            });
+        }
+    }
+    
+    void handle_client_event(ClientEventHandler* conn, EventType events) {
+        dispatching_ = true;
+        process_client_event(conn, events);
+        dispatching_ = false;
+        flush_pending();
+    }
+    
+    // 处理客户端事件，连接被关闭时返回false
+    bool process_client_event(ClientEventHandler* conn, EventType events) {
+        int fd = conn->get_fd();
+        
+        if ((static_cast<int>(events) & static_cast<int>(EventType::READ)) &&
+            !conn->read_paused && !conn->close_after_drain && !conn->offload_blocked) {
+            // 边缘触发下必须读到EAGAIN，否则剩余数据不会再通知；
+            // 中途因工作线程队列满而停止时，恢复读取会重新注册事件
+            bool drain = event_loop_->edge_triggered();
             
-            if (n > 0) {
-                buffer[n] = '\0';
-                conn_handler_->on_data(fd, buffer, n);
-            } else {
-                // 连接关闭
-                conn_handler_->on_closed(fd);
-                close_connection(fd);
+            while (!conn->close_after_drain && !conn->offload_blocked) {
+                conn->input.ensure_writable(4096);
+                ssize_t n = read(fd, conn->input.write_ptr(), conn->input.writable());
+                
+                if (n > 0) {
+                    conn->input.has_written(static_cast<size_t>(n));
+                    conn->last_active = event_loop_->now_ms();
+                    conn->bytes_in += n;
+                    stats_.bytes_in += n;
+                    
+                    if (!process_input(conn)) {
+                        return false;
+                    }
+                    
+                    // 未读满不代表接收队列已空（例如FIN排在数据后面），边缘触发下继续读到EAGAIN或0
+                    if (!drain) {
+                        break;
+                    }
+                    // 输出积压过多，先停止读取，等发送缓冲区排空后再恢复；
+                    // 没读到EAGAIN，必须标记暂停，恢复时才会重新注册以补发边缘事件
+                    if (options_.output_high_water > 0 &&
+                        conn->output.size() >= options_.output_high_water) {
+                        conn->read_paused = true;
+                        break;
+                    }
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                } else if (n == 0 && (!conn->output.empty() || conn->offloaded > 0)) {
+                    // 对端关闭了写方向，FIN可能与最后的请求一起读到：先把已产生的回复发完再关闭
+                    conn_handler_->on_closed(fd);
+                    conn->close_after_drain = true;
+                    output_added(conn);
+                    break;
+                } else {
+                    // 连接关闭或出错
+                    conn_handler_->on_closed(fd);
+                    close_connection(fd);
+                    return false;
+                }
+            }
+        }
+        
+        if (static_cast<int>(events) & static_cast<int>(EventType::WRITE)) {
+            if (!flush_connection(conn)) {
+                return false;
             }
         }
         
         if (static_cast<int>(events) & static_cast<int>(EventType::ERROR)) {
             conn_handler_->on_closed(fd);
             close_connection(fd);
+            return false;
+        }
+        return true;
+    }
+    
+    // 处理缓冲区中所有完整的请求，剩余的半截请求留到下次；连接被关闭时返回false
+    bool process_input(ClientEventHandler* conn) {
+        int fd = conn->get_fd();
+        size_t used = conn_handler_->on_data(fd, conn->input.data(), conn->input.size());
+        if (conn->closed) {
+            return false;  // 处理器在on_data中调用了disconnect
+        }
+        conn->input.consume(used);
+        return check_input_limit(conn);
+    }
+    
+    bool check_input_limit(ClientEventHandler* conn) {
+        if (conn->input.size() > options_.max_input_buffer) {
+            int fd = conn->get_fd();
+            LOG_WARN("请求过长，断开连接 fd=" << fd);
+            conn_handler_->on_closed(fd);
+            close_connection(fd);
+            return false;
+        }
+        return true;
+    }
+    
+    // 完成式事件循环：接受到新连接
+    void handle_accepted(int client_fd, const sockaddr_in& addr) {
+        dispatching_ = true;
+        setup_connection(client_fd, addr);
+        dispatching_ = false;
+        flush_pending();
+    }
+    
+    // 完成式事件循环：数据直接在内核提供的缓冲区中，没有积压时不经过输入缓冲区
+    void handle_client_recv(ClientEventHandler* conn, const char* data, ssize_t len) {
+        int fd = conn->get_fd();
+        dispatching_ = true;
+        
+        if (len > 0) {
+            conn->last_active = event_loop_->now_ms();
+            conn->bytes_in += len;
+            stats_.bytes_in += len;
+        }
+        
+        if (len == 0 && !conn->close_after_drain &&
+            (!conn->output.empty() || conn->send_inflight || conn->offloaded > 0 || conn->offload_blocked)) {
+            // 对端关闭了写方向：先把已产生的回复发完再关闭
+            conn_handler_->on_closed(fd);
+            conn->close_after_drain = true;
+            output_added(conn);
+        } else if (len <= 0) {
+            if (!conn->close_after_drain) {
+                conn_handler_->on_closed(fd);
+            }
+            close_connection(fd);
+        } else if (conn->close_after_drain) {
+            // 等待输出发送完后关闭，之后收到的数据直接丢弃
+        } else if (conn->offload_blocked) {
+            // 完成式事件循环无法暂停接收，先积压在输入缓冲区，重试时一起处理
+            conn->input.append(data, static_cast<size_t>(len));
+            check_input_limit(conn);
+        } else if (conn->input.empty()) {
+            size_t used = conn_handler_->on_data(fd, data, static_cast<size_t>(len));
+            if (used < static_cast<size_t>(len) && !conn->closed) {
+                conn->input.append(data + used, len - used);
+                check_input_limit(conn);
+            }
+        } else {
+            conn->input.append(data, static_cast<size_t>(len));
+            process_input(conn);
+        }
+        
+        dispatching_ = false;
+        flush_pending();
+    }
+    
+    // 完成式事件循环：发送完成
+    void handle_client_send(ClientEventHandler* conn, ssize_t len) {
+        conn->send_inflight = false;
+        
+        if (conn->closed) {
+            // 连接已经关闭，现在可以回收输出缓冲区了
+            for (auto it = closing_handlers_.begin(); it != closing_handlers_.end(); ++it) {
+                if (it->get() == conn) {
+                    free_handlers_.push_back(std::move(*it));
+                    closing_handlers_.erase(it);
+                    break;
+                }
+            }
+            return;
+        }
+        
+        if (len < 0) {
+            int fd = conn->get_fd();
+            if (!conn->close_after_drain) {
+                conn_handler_->on_closed(fd);
+            }
+            close_connection(fd);
+            return;
+        }
+        
+        conn->output.consume(static_cast<size_t>(len));
+        conn->last_active = event_loop_->now_ms();
+        conn->bytes_out += len;
+        stats_.bytes_out += len;
+        flush_connection(conn);
+    }
+    
+    // 刷新本轮产生输出的连接，每个连接一次writev
+    void flush_pending() {
+        if (pending_flush_.empty()) return;
+        
+        std::vector<int> fds;
+        fds.swap(pending_flush_);
+        
+        for (int fd : fds) {
+            ClientEventHandler* conn = find_connection(fd);
+            if (!conn) continue;
+            
+            conn->flush_pending = false;
+            
+            if (static_cast<int>(conn->interest) & static_cast<int>(EventType::WRITE)) {
+                // 已在等待可写事件，此时写只会得到EAGAIN
+                update_interest(conn);
+            } else {
+                flush_connection(conn);
+            }
+        }
+        
+        if (pending_flush_.empty()) {
+            pending_flush_.swap(fds);
+            pending_flush_.clear();
         }
     }
     
-    void accept_connection() {
+    // 尽可能发送输出缓冲区，出错时关闭连接并返回false
+    bool flush_connection(ClientEventHandler* conn) {
+        int fd = conn->get_fd();
+        
+        if (event_loop_->completion_based()) {
+            // 一次只提交一个发送请求，完成后再发送剩余部分
+            if (!conn->send_inflight && !conn->output.empty()) {
+                iovec iov[64];
+                int count = conn->output.fill_iovec(iov, 64);
+                conn->send_inflight = event_loop_->async_send(fd, iov, count, conn);
+            }
+            return !close_if_drained(conn);
+        }
+        
+        if (!conn->output.empty()) {
+            ssize_t written = conn->output.write_to(fd);
+            if (written < 0) {
+                if (!conn->close_after_drain) {
+                    conn_handler_->on_closed(fd);
+                }
+                close_connection(fd);
+                return false;
+            }
+            if (written > 0) {
+                conn->last_active = event_loop_->now_ms();
+                conn->bytes_out += written;
+                stats_.bytes_out += written;
+            }
+        }
+        
+        if (close_if_drained(conn)) {
+            return false;
+        }
+        update_interest(conn);
+        return true;
+    }
+    
+    // close_after_drain的连接没有待发送的数据、也没有等待工作线程的回复时关闭，返回是否已关闭
+    bool close_if_drained(ClientEventHandler* conn) {
+        if (!conn->close_after_drain || !conn->output.empty() ||
+            conn->send_inflight || conn->offloaded > 0 || conn->offload_blocked) {
+            return false;
+        }
+        close_connection(conn->get_fd());
+        return true;
+    }
+    
+    // 根据输出积压情况调整注册的事件：有未发送数据时关注EPOLLOUT，
+    // 超过高水位时暂停读取，回落到一半以下时恢复
+    void update_interest(ClientEventHandler* conn) {
+        size_t high_water = options_.output_high_water;
+        size_t pending = conn->output.size();
+        bool resumed = false;   // 恢复读取，边缘触发下需要重新注册才会报告已在缓冲区中的数据
+        
+        if (high_water > 0) {
+            if (!conn->read_paused && pending >= high_water) {
+                conn->read_paused = true;
+            } else if (conn->read_paused && pending <= high_water / 2) {
+                conn->read_paused = false;
+                resumed = true;
+            }
+        } else {
+            resumed = conn->read_paused;
+            conn->read_paused = false;
+        }
+        
+        int events = 0;
+        if (!conn->read_paused && !conn->close_after_drain && !conn->offload_blocked) {
+            events |= static_cast<int>(EventType::READ);
+        }
+        if (pending > 0) events |= static_cast<int>(EventType::WRITE);
+        
+        if (events != static_cast<int>(conn->interest) || resumed) {
+            conn->interest = static_cast<EventType>(events);
+            event_loop_->mod_event(conn->get_fd(), conn->interest, conn);
+        }
+    }
+    
+    // 接受一个连接，返回false表示本轮无需继续accept
+    bool accept_connection() {
         sockaddr_in client_addr{};
         socklen_t addr_len = sizeof(client_addr);
         
-        int client_fd = accept(server_fd_, 
-                              reinterpret_cast<sockaddr*>(&client_addr), 
-                              &addr_len);
+        int client_fd = accept4(server_fd_, 
+                               reinterpret_cast<sockaddr*>(&client_addr), 
+                               &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
         
         if (client_fd < 0) {
-            perror("accept失败");
-            return;
+            if (errno == EINTR || errno == ECONNABORTED) {
+                return true;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept失败");
+            }
+            return false;
+        }
+        
+        setup_connection(client_fd, client_addr);
+        return true;
+    }
+    
+    void setup_connection(int client_fd, const sockaddr_in& client_addr) {
+        if (options_.tcp_nodelay) {
+            int opt = 1;
+            setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        }
+        if (options_.so_busy_poll_us > 0 &&
+            setsockopt(client_fd, SOL_SOCKET, SO_BUSY_POLL,
+                       &options_.so_busy_poll_us, sizeof(options_.so_busy_poll_us)) < 0 &&
+            !busy_poll_warned_) {
+            busy_poll_warned_ = true;
+            perror("设置SO_BUSY_POLL失败");
         }
         
-        // 设置非阻塞
-        fcntl(client_fd, F_SETFL, O_NONBLOCK);
+        if (static_cast<size_t>(client_fd) >= connections_.size()) {
+            connections_.resize(client_fd + 1);
+        }
         
-        // 创建客户端事件处理器
-        auto handler = std::make_unique<ClientEventHandler>(this, client_fd);
+        // 优先复用该fd上次使用的对象，其次是回收池，都没有时才分配
+        std::unique_ptr<ClientEventHandler>& slot = connections_[client_fd];
+        if (!slot) {
+            if (!free_handlers_.empty()) {
+                slot = std::move(free_handlers_.back());
+                free_handlers_.pop_back();
+            } else {
+                slot = std::make_unique<ClientEventHandler>(this, client_fd);
+            }
+        }
+        ClientEventHandler* conn = slot.get();
+        conn->reset(client_fd);
+        conn->id = ++next_conn_id_;
         
         // 添加到事件循环
-        if (event_loop_->add_event(client_fd, EventType::READ, handler.get())) {
-            client_handlers_[client_fd] = std::move(handler);
+        bool added = event_loop_->completion_based()
+            ? event_loop_->async_recv(client_fd, conn)
+            : event_loop_->add_event(client_fd, EventType::READ, conn);
+        
+        if (added) {
+            active_connections_++;
+            stats_.accepted++;
+            
+            conn->last_active = event_loop_->now_ms();
+            if (options_.idle_timeout_ms > 0) {
+                arm_idle_timer(conn, options_.idle_timeout_ms);
+            }
+            
             conn_handler_->on_connected(client_fd, client_addr);
         } else {
+            conn->closed = true;
             close(client_fd);
         }
     }
     
+    // 每个连接一个定时器；收发数据时只更新last_active，定时器到期时再根据
+    // 实际空闲时间决定断开还是重新定时，避免每次收发都重排定时器
+    void arm_idle_timer(ClientEventHandler* conn, uint64_t delay_ms) {
+        conn->idle_timer = event_loop_->run_after(static_cast<int>(delay_ms),
+            [this, conn]() { check_idle(conn); });
+    }
+    
+    void check_idle(ClientEventHandler* conn) {
+        conn->idle_timer = 0;
+        
+        uint64_t timeout = static_cast<uint64_t>(options_.idle_timeout_ms);
+        uint64_t idle = event_loop_->now_ms() - conn->last_active;
+        if (idle < timeout) {
+            arm_idle_timer(conn, timeout - idle);
+            return;
+        }
+        
+        int fd = conn->get_fd();
+        LOG_INFO("连接空闲超时，断开 fd=" << fd);
+        stats_.idle_closed++;
+        conn_handler_->on_closed(fd);
+        close_connection(fd);
+    }
+    
+    // 取出工作线程送回的结果，写入仍然存在的连接
+    void handle_replies() {
+        uint64_t value;
+        while (read(reply_fd_, &value, sizeof(value)) < 0 && errno == EINTR) {}
+        
+        // 先清除标志再取队列，之后入队的回复会重新写eventfd
+        reply_wakeup_pending_.store(false);
+        
+        dispatching_ = true;
+        Reply reply;
+        while (replies_.pop(reply)) {
+            ClientEventHandler* conn = find_connection(reply.fd);
+            if (!conn || conn->id != reply.conn_id) {
+                continue;
+            }
+            conn->offloaded--;
+            if (!reply.data.empty()) {
+                send(reply.fd, reply.data.data(), reply.data.size());
+            } else if (conn->close_after_drain) {
+                output_added(conn);   // 最后一个回复为空时也要检查能否关闭
+            }
+        }
+        dispatching_ = false;
+        flush_pending();
+        
+        // 工作线程取走了任务，队列有了空位
+        retry_offload();
+    }
+    
+    // 重新处理因工作线程队列满而留在输入缓冲区的请求；仍然提交不了的连接会再次登记
+    void retry_offload() {
+        event_loop_->cancel_timer(offload_retry_timer_);
+        offload_retry_timer_ = 0;
+        if (offload_blocked_.empty()) return;
+        
+        std::vector<int> fds;
+        fds.swap(offload_blocked_);
+        
+        dispatching_ = true;
+        for (int fd : fds) {
+            ClientEventHandler* conn = find_connection(fd);
+            if (!conn || !conn->offload_blocked) continue;
+            
+            conn->offload_blocked = false;
+            if (!process_input(conn)) continue;
+            // 恢复读取（或在close_after_drain时检查能否关闭），本轮结束时统一更新注册的事件
+            output_added(conn);
+        }
+        dispatching_ = false;
+        flush_pending();
+    }
+    
+    // 登记一个提交失败的连接：停止读取，请求留在输入缓冲区。
+    // 多reactor共享工作线程池时队列可能被其他reactor的任务占满，本服务器不一定收到回复，另用定时器兜底
+    void block_offload(ClientEventHandler* conn) {
+        if (!conn->offload_blocked) {
+            conn->offload_blocked = true;
+            offload_blocked_.push_back(conn->get_fd());
+            // 完成式事件循环不能暂停接收，也不使用interest
+            if (!event_loop_->completion_based()) {
+                update_interest(conn);
+            }
+        }
+        if (offload_retry_timer_ == 0) {
+            offload_retry_timer_ = event_loop_->run_after(1, [this]() {
+                offload_retry_timer_ = 0;
+                retry_offload();
+            });
+        }
+    }
+    
+    bool setup_reply_channel() {
+        reply_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (reply_fd_ < 0) {
+            perror("创建eventfd失败");
+            return false;
+        }
+        reply_handler_ = std::make_unique<ReplyEventHandler>(this, reply_fd_);
+        if (!event_loop_->add_event(reply_fd_, EventType::READ, reply_handler_.get())) {
+            LOG_ERROR("添加回复通知事件失败");
+            close(reply_fd_);
+            reply_fd_ = -1;
+            return false;
+        }
+        return true;
+    }
+    
+    // 定期输出统计信息
+    void report_stats() {
+        LOG_INFO("[统计] " << event_loop_->name()
+                  << " 当前连接=" << active_connections_
+                  << ", 累计接受=" << stats_.accepted
+                  << ", 累计关闭=" << stats_.closed
+                  << " (空闲超时" << stats_.idle_closed << ")"
+                  << ", 接收=" << stats_.bytes_in << "B"
+                  << ", 发送=" << stats_.bytes_out << "B");
+        if (options_.busy_poll_us > 0) {
+            BusyPollStats busy = event_loop_->busy_poll_stats();
+            LOG_INFO("[统计] 忙轮询 自旋命中=" << busy.spin_hits
+                      << ", 自旋超时=" << busy.spin_timeouts
+                      << ", 阻塞等待=" << busy.blocking_waits);
+        }
+    }
+    
     void close_connection(int fd) {
         event_loop_->del_event(fd);
-        client_handlers_.erase(fd);
+        
+        ClientEventHandler* conn = find_connection(fd);
+        if (conn) {
+            event_loop_->cancel_timer(conn->idle_timer);
+            conn->closed = true;
+            active_connections_--;
+            stats_.closed++;
+            if (conn->send_inflight) {
+                // 内核还在读取输出缓冲区，等发送完成回调后再回收
+                closing_handlers_.push_back(std::move(connections_[fd]));
+            }
+        }
         close(fd);
     }
     
 public:
     NetworkServer(std::unique_ptr<EventLoop> loop, 
-                  std::unique_ptr<ConnectionHandler> handler)
+                  std::unique_ptr<ConnectionHandler> handler,
+                  const ServerOptions& options = ServerOptions())
         : event_loop_(std::move(loop))
-        , conn_handler_(std::move(handler)) {}
+        , conn_handler_(std::move(handler))
+        , options_(options) {}
     
     ~NetworkServer() {
+        // 先让工作线程退出，它们会访问回复队列和eventfd
+        if (own_workers_) {
+            own_workers_->stop();
+        }
         stop();
+        if (reply_fd_ >= 0) {
+            close(reply_fd_);
+            reply_fd_ = -1;
+        }
     }
     
     bool start(const std::string& host, int port) {
         // 创建socket
-        server_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        server_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
         if (server_fd_ < 0) {
             perror("创建socket失败");
             return false;
@@ -154,6 +792,14 @@ public:
             return false;
         }
         
+        // 多reactor模式下每个loop各自监听，由内核在它们之间分发连接
+        if (options_.reuse_port &&
+            setsockopt(server_fd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+            perror("设置SO_REUSEPORT失败");
+            close(server_fd_);
+            return false;
+        }
+        
         // 绑定地址
         sockaddr_in addr{};
         addr.sin_family = AF_INET;
@@ -163,7 +809,7 @@ public:
             addr.sin_addr.s_addr = INADDR_ANY;
         } else {
             if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) <= 0) {
-                std::cerr << "无效的IP地址: " << host << std::endl;
+                LOG_ERROR("无效的IP地址: " << host);
                 close(server_fd_);
                 return false;
             }
@@ -175,32 +821,60 @@ public:
             return false;
         }
         
+        // 连接建立后等客户端发来数据再通知accept，省掉一次唤醒
+        if (options_.defer_accept_sec > 0 &&
+            setsockopt(server_fd_, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                       &options_.defer_accept_sec, sizeof(options_.defer_accept_sec)) < 0) {
+            perror("设置TCP_DEFER_ACCEPT失败");
+            close(server_fd_);
+            return false;
+        }
+        
         // 监听
-        if (listen(server_fd_, 128) < 0) {
+        if (listen(server_fd_, options_.backlog) < 0) {
             perror("监听失败");
             close(server_fd_);
             return false;
         }
         
-        // 设置非阻塞
-        fcntl(server_fd_, F_SETFL, O_NONBLOCK);
-        
         // 创建服务器事件处理器
         server_handler_ = std::make_unique<ServerEventHandler>(this, server_fd_);
         
         // 添加到事件循环
-        if (!event_loop_->add_event(server_fd_, EventType::READ, server_handler_.get())) {
-            std::cerr << "添加服务器事件失败" << std::endl;
+        bool added = event_loop_->completion_based()
+            ? event_loop_->async_accept(server_fd_, server_handler_.get())
+            : event_loop_->add_event(server_fd_, EventType::READ, server_handler_.get());
+        if (!added) {
+            LOG_ERROR("添加服务器事件失败");
             close(server_fd_);
             return false;
         }
         
-        std::cout << "服务器启动在 " 
+        if (!workers_ && options_.worker_threads > 0) {
+            own_workers_ = std::make_unique<WorkerPool>(options_.worker_threads);
+            workers_ = own_workers_.get();
+        }
+        if (workers_ && !setup_reply_channel()) {
+            close(server_fd_);
+            server_fd_ = -1;
+            return false;
+        }
+        
+        if (options_.busy_poll_us > 0 && !event_loop_->set_busy_poll(options_.busy_poll_us)) {
+            LOG_WARN("事件模型" << event_loop_->name() << "不支持忙轮询，忽略");
+            options_.busy_poll_us = 0;
+        }
+        
+        if (options_.stats_interval_ms > 0) {
+            stats_timer_ = event_loop_->run_every(options_.stats_interval_ms,
+                [this]() { report_stats(); });
+        }
+        
+        LOG_INFO("服务器启动在 " 
                   << (host.empty() ? "0.0.0.0" : host) 
                   << ":" << port 
                   << "，使用事件模型: " 
-                  << (dynamic_cast<PollLoop*>(event_loop_.get()) ? "poll" : "epoll")
-                  << std::endl;
+                  << event_loop_->name());
         
         return true;
     }
@@ -214,12 +888,22 @@ public:
     void stop() {
         if (event_loop_) {
             event_loop_->stop();
+            event_loop_->cancel_timer(stats_timer_);
+            stats_timer_ = 0;
+            event_loop_->cancel_timer(offload_retry_timer_);
+            offload_retry_timer_ = 0;
         }
         
-        for (auto& pair : client_handlers_) {
-            close(pair.first);
+        for (auto& conn : connections_) {
+            if (!conn || conn->closed) continue;
+            if (event_loop_) {
+                event_loop_->cancel_timer(conn->idle_timer);
+            }
+            conn->closed = true;
+            close(conn->get_fd());
         }
-        client_handlers_.clear();
+        active_connections_ = 0;
+        closing_handlers_.clear();
         
         if (server_fd_ >= 0) {
             close(server_fd_);
@@ -227,18 +911,202 @@ public:
         }
     }
     
+    // 数据先进入连接的输出缓冲区；事件处理期间产生的输出在本轮结束时
+    // 合并为一次writev，未发完的部分等待EPOLLOUT继续发送
     bool send(int client_fd, const char* data, size_t len) {
-        ssize_t n = write(client_fd, data, len);
-        return n == static_cast<ssize_t>(len);
+        ClientEventHandler* conn = find_connection(client_fd);
+        if (!conn) {
+            return false;
+        }
+        
+        conn->output.append(data, len);
+        return output_added(conn);
     }
     
     bool send(int client_fd, const std::string& data) {
         return send(client_fd, data.c_str(), data.length());
     }
     
+    // 直接访问连接的输出缓冲区，省去send的一次拷贝；只能在事件循环线程中使用。
+    // 写入后调用commit_output安排发送。连接不存在时返回nullptr
+    OutputBuffer* output_buffer(int client_fd) {
+        ClientEventHandler* conn = find_connection(client_fd);
+        return conn ? &conn->output : nullptr;
+    }
+    
+    bool commit_output(int client_fd) {
+        ClientEventHandler* conn = find_connection(client_fd);
+        if (!conn) {
+            return false;
+        }
+        return conn->output.empty() || output_added(conn);
+    }
+    
+private:
+    // 输出缓冲区有新数据：事件处理期间延后到本轮结束时统一发送，否则立即发送
+    bool output_added(ClientEventHandler* conn) {
+        int client_fd = conn->get_fd();
+        if (dispatching_) {
+            if (!conn->flush_pending) {
+                conn->flush_pending = true;
+                pending_flush_.push_back(client_fd);
+            }
+            return true;
+        }
+        
+        if (static_cast<int>(conn->interest) & static_cast<int>(EventType::WRITE)) {
+            update_interest(conn);
+            return true;
+        }
+        return flush_connection(conn);
+    }
+    
+public:
+    // 工作线程模式下把一个连接的一批请求交给工作线程执行，work的返回值为要发给该连接的数据。
+    // 同一连接的任务总是分到同一个工作线程，回复顺序与请求顺序一致；未启用工作线程时返回false。
+    // 工作线程的队列满时也返回false并暂停读取该连接：on_data应不消费这批请求，
+    // 服务器取回回复后（或1ms后）用输入缓冲区中的数据重新调用on_data
+    bool offload(int client_fd, std::function<std::string()> work) {
+        ClientEventHandler* conn = find_connection(client_fd);
+        if (!workers_ || !conn) {
+            return false;
+        }
+        
+        uint64_t conn_id = conn->id;
+        bool submitted = workers_->try_submit(conn_id, [this, client_fd, conn_id, work = std::move(work)]() {
+            Reply reply;
+            reply.fd = client_fd;
+            reply.conn_id = conn_id;
+            reply.data = work();
+            replies_.push(std::move(reply));
+            
+            // 事件循环还没处理上一次通知时不必重复写eventfd
+            if (!reply_wakeup_pending_.exchange(true)) {
+                uint64_t one = 1;
+                ssize_t ret = write(reply_fd_, &one, sizeof(one));
+                (void)ret;
+            }
+        });
+        if (!submitted) {
+            block_offload(conn);
+            return false;
+        }
+        conn->offloaded++;
+        return true;
+    }
+    
+    bool has_workers() const { return workers_ != nullptr; }
+    
+    // 使用外部的工作线程池（需在start之前调用），池必须比服务器先停止
+    void set_worker_pool(WorkerPool* pool) {
+        workers_ = pool;
+    }
+    
     void disconnect(int client_fd) {
         close_connection(client_fd);
     }
     
+    // 停止读取，等已产生的输出（包括工作线程尚未返回的回复）发送完后再关闭，
+    // 用于先回复错误信息再断开的场合
+    void disconnect_after_flush(int client_fd) {
+        ClientEventHandler* conn = find_connection(client_fd);
+        if (!conn) {
+            return;
+        }
+        conn->close_after_drain = true;
+        output_added(conn);
+    }
+    
+    void set_handler(std::unique_ptr<ConnectionHandler> handler) {
+        conn_handler_ = std::move(handler);
+    }
+    
     int get_server_fd() const { return server_fd_; }
+    
+    const ServerStats& stats() const { return stats_; }
+};
+
+// 多reactor服务器：每个线程一个事件循环和一个SO_REUSEPORT监听socket，
+// 连接由内核分发，各线程的连接表互不共享
+class MultiReactorServer {
+public:
+    // 为每个reactor创建连接处理器
+    using HandlerFactory = std::function<std::unique_ptr<ConnectionHandler>(NetworkServer*)>;
+    
+private:
+    std::string loop_type_;
+    int num_threads_;
+    HandlerFactory factory_;
+    ServerOptions options_;
+    std::unique_ptr<WorkerPool> workers_;  // 所有reactor共享的工作线程池
+    std::vector<std::unique_ptr<NetworkServer>> servers_;
+    std::vector<std::thread> threads_;
+    
+public:
+    MultiReactorServer(const std::string& loop_type, int num_threads,
+                       HandlerFactory factory,
+                       const ServerOptions& options = ServerOptions())
+        : loop_type_(loop_type)
+        , num_threads_(num_threads > 0 ? num_threads : 1)
+        , factory_(std::move(factory))
+        , options_(options) {
+        options_.reuse_port = true;
+    }
+    
+    ~MultiReactorServer() {
+        stop();
+        join();
+        if (workers_) {
+            workers_->stop();
+        }
+    }
+    
+    bool start(const std::string& host, int port) {
+        if (options_.worker_threads > 0) {
+            workers_ = std::make_unique<WorkerPool>(options_.worker_threads);
+        }
+        
+        for (int i = 0; i < num_threads_; i++) {
+            auto server = std::make_unique<NetworkServer>(
+                EventLoop::create(loop_type_), nullptr, options_);
+            server->set_handler(factory_(server.get()));
+            server->set_worker_pool(workers_.get());
+            
+            if (!server->start(host, port)) {
+                servers_.clear();
+                return false;
+            }
+            servers_.push_back(std::move(server));
+        }
+        return true;
+    }
+    
+    // 在各自线程中运行所有事件循环，阻塞到全部退出
+    void run() {
+        for (auto& server : servers_) {
+            threads_.emplace_back([&server]() { server->run(); });
+        }
+        join();
+    }
+    
+    void stop() {
+        for (auto& server : servers_) {
+            server->event_loop_->stop();
+        }
+    }
+    
+    size_t size() const { return servers_.size(); }
+    
+    // 第i个reactor的事件循环，可以在run()之前安排定时器
+    EventLoop* event_loop(size_t i) { return servers_[i]->event_loop_.get(); }
+    
+private:
+    void join() {
+        for (auto& t : threads_) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+        threads_.clear();
+    }
 };
\ No newline at end of file
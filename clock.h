@@ -0,0 +1,99 @@
+//clock.h
+#pragma once
+#include "config.h"
+#include <atomic>
+
+// CLOCK（二次机会）淘汰：节点按插入顺序连成一个环，访问时只置位节点的引用位而不移动节点，
+// 所以读操作在共享锁下即可完成。需要淘汰时指针沿环扫描：引用位为1的清零后跳过（第二次机会），
+// 遇到引用位为0的节点就淘汰它。
+// 与IntrusiveLRU不同，这里不维护key到节点的索引，查找完全交给哈希表；节点由ClockCache拥有
+class ClockCache {
+private:
+    DataNode* hand = nullptr;   // 下一个检查的节点，为nullptr时环为空
+    int current_size = 0;
+    int max_size;
+
+    // 从环中摘下节点
+    void unlink(DataNode* node) {
+        if (node->lru_next == node) {
+            hand = nullptr;
+        }
+        else {
+            node->lru_prev->lru_next = node->lru_next;
+            node->lru_next->lru_prev = node->lru_prev;
+            if (hand == node) hand = node->lru_next;
+        }
+        node->lru_prev = nullptr;
+        node->lru_next = nullptr;
+        current_size--;
+    }
+
+public:
+    explicit ClockCache(int capacity) : max_size(capacity) {}
+
+    ~ClockCache() {
+        clear();
+    }
+
+    // 记录一次访问，多个读线程可以并发调用。已经置位时不再写，避免读线程反复写同一缓存行
+    static void touch(DataNode* node) {
+        if (!node->referenced.load(std::memory_order_relaxed)) {
+            node->referenced.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // 加入新节点，放在指针之前（转一整圈后才检查到它）。
+    // 已满时先淘汰一个节点并返回，由调用方从哈希表中删除并释放
+    DataNode* insert(DataNode* node) {
+        DataNode* evicted = nullptr;
+        if (current_size >= max_size) {
+            evicted = evict();
+        }
+
+        node->referenced.store(false, std::memory_order_relaxed);
+        if (!hand) {
+            node->lru_prev = node->lru_next = node;
+            hand = node;
+        }
+        else {
+            node->lru_next = hand;
+            node->lru_prev = hand->lru_prev;
+            hand->lru_prev->lru_next = node;
+            hand->lru_prev = node;
+        }
+        current_size++;
+
+        return evicted;
+    }
+
+    // 扫描到第一个引用位为0的节点并摘下它；最多转一圈就会清掉所有引用位
+    DataNode* evict() {
+        if (!hand) return nullptr;
+
+        while (hand->referenced.load(std::memory_order_relaxed)) {
+            hand->referenced.store(false, std::memory_order_relaxed);
+            hand = hand->lru_next;
+        }
+
+        DataNode* victim = hand;
+        unlink(victim);
+        return victim;
+    }
+
+    // 摘下节点（不释放）
+    void remove(DataNode* node) {
+        unlink(node);
+    }
+
+    // 清空并删除所有节点
+    void clear() {
+        while (hand) {
+            DataNode* node = hand;
+            unlink(node);
+            delete node;
+        }
+    }
+
+    int get_size() const { return current_size; }
+    int get_capacity() const { return max_size; }
+};
@@ -3,169 +3,456 @@
 #include "network.h"
 #include "storage_engine.h"
 #include "client.h"
-#include <sstream>
-#include <iostream>
+#include "coro.h"
+#include "command_parser.h"
+#include "binary_protocol.h"
+#include <charconv>
 #include <algorithm>
+#include <cstring>
+#include <climits>
 
 class CommandHandler : public ConnectionHandler {
 private:
     NetworkServer* server_;
     StorageEngine& storage_engine_;
 
-    // ַָ
-    std::vector<std::string> split(const std::string& str, char delimiter) {
-        std::vector<std::string> tokens;
-        std::string token;
-        std::istringstream tokenStream(str);
-        while (std::getline(tokenStream, token, delimiter)) {
-            if (!token.empty()) {
-                tokens.push_back(token);
+    // ʹõЭ飬ɵһֽھ
+    enum class Protocol : uint8_t {
+        UNKNOWN,
+        TEXT,
+        BINARY
+    };
+    std::vector<Protocol> protocols_;   // fd -> Э飬ֻ¼ѭ߳з
+
+    // ޸ֶεĽ
+    enum class SetStatus {
+        OK,
+        INVALID_ID,
+        INVALID_CASH,
+        INVALID_FIELD,
+        FAILED
+    };
+
+    // Э鹲õĴ洢ȡû
+    std::pair<bool, User> lookup_user(int client_fd, std::string_view key) {
+        LOG_DEBUG("[GET] fd=" << client_fd << ", key=" << key);
+
+        // keystd::stringڣڴ
+        auto result = storage_engine_.get(std::string(key));
+
+        if (result.first) {
+            LOG_DEBUG("[GET] ɹҵû: id=" << result.second.id
+                << ", name=" << result.second.name);
+        }
+        else {
+            LOG_DEBUG("[GET] δҵû: key=" << key);
+        }
+        return result;
+    }
+
+    // Э鹲õĴ洢޸ûһֶΣûʱ
+    // cashΪnullptrʱֱʹãЭ飩valueıЭ飩
+    SetStatus update_user(int client_fd, std::string_view key, UserField field,
+        std::string_view field_name, std::string_view value, const long long* cash) {
+        LOG_DEBUG("[SET] fd=" << client_fd << ", field=" << field_name
+            << ", key=" << key << ", value=" << value);
+
+        // Уڴ洢һμԭ޸
+        long long amount = 0;
+        switch (field) {
+        case UserField::NAME:
+        case UserField::EMAIL:
+        case UserField::PHONE:
+            break;
+        case UserField::CASH:
+            if (cash) {
+                amount = *cash;
+            }
+            else if (!parse_integer(value, amount)) {
+                LOG_DEBUG("[SET] ЧĽ: " << value);
+                return SetStatus::INVALID_CASH;
+            }
+            break;
+        default:
+            LOG_DEBUG("[SET] Чֶ: " << field_name);
+            return SetStatus::INVALID_FIELD;
+        }
+
+        auto status = storage_engine_.update(std::string(key), [&](User& user) {
+            // fieldûϢ
+            switch (field) {
+            case UserField::NAME:
+                user.name = value;
+                break;
+            case UserField::EMAIL:
+                user.email = value;
+                break;
+            case UserField::PHONE:
+                user.phone = value;
+                break;
+            default:
+                user.cash = amount;  // ý
+                break;
             }
+            return true;
+        }, [key](User& user) { return new_user(key, user); });
+
+        switch (status) {
+        case StorageEngine::UpdateStatus::UPDATED:
+            LOG_DEBUG("[SET] ɹ: key=" << key
+                << ", field=" << field_name);
+            return SetStatus::OK;
+        case StorageEngine::UpdateStatus::NOT_FOUND:
+            LOG_DEBUG("[SET] ЧID: " << key);
+            return SetStatus::INVALID_ID;
+        default:
+            LOG_WARN("[SET] 洢ʧ: key=" << key);
+            return SetStatus::FAILED;
         }
-        return tokens;
     }
 
-    // ַƳзͿո
-    void trim(std::string& s) {
-        s.erase(std::remove(s.begin(), s.end(), '\n'), s.end());
-        s.erase(std::remove(s.begin(), s.end(), '\r'), s.end());
-        // Ƴβո
-        s.erase(0, s.find_first_not_of(' '));
-        s.erase(s.find_last_not_of(' ') + 1);
+    static const char* set_error_message(SetStatus status) {
+        switch (status) {
+        case SetStatus::INVALID_ID: return "ЧID";
+        case SetStatus::INVALID_CASH: return "ЧĽ";
+        case SetStatus::INVALID_FIELD: return "Чֶ";
+        case SetStatus::FAILED: return "洢ʧ";
+        default: return "";
+        }
     }
 
     // GET
-    void handle_get(int client_fd, const std::string& key) {
-        std::cout << "[GET] fd=" << client_fd << ", key=" << key << std::endl;
-
-        auto result = storage_engine_.get(key);
+    template<typename Reply>
+    void handle_get(int client_fd, std::string_view key, Reply& reply) {
+        auto result = lookup_user(client_fd, key);
 
         if (result.first) {
-            std::stringstream ss;
-            ss << "data/"
-                << result.second.id << "/"
-                << result.second.name << "/"
-                << result.second.email << "/"
-                << result.second.phone << "/"
-                << result.second.cash << "\n";
-
-            server_->send(client_fd, ss.str());
-            std::cout << "[GET] ɹҵû: id=" << result.second.id
-                << ", name=" << result.second.name << std::endl;
+            append_user(result.second, reply);
         }
         else {
-            server_->send(client_fd, "fail\n");
-            std::cout << "[GET] δҵû: key=" << key << std::endl;
+            reply += "fail\n";
         }
     }
 
-    // SET
-    void handle_set(int client_fd, const std::string& field,
-        const std::string& key, const std::string& value) {
-        std::cout << "[SET] fd=" << client_fd << ", field=" << field
-            << ", key=" << key << ", value=" << value << std::endl;
-
-        auto result = storage_engine_.get(key);
-
-        if (!result.first) {
-            // ûڣkeyʹû
-            if (isdigit(key[0])) {
-                // key֣Ϊid
-                try {
-                    int id = std::stoi(key);
-                    result.second = User(id, "Ա");
-                }
-                catch (const std::exception& e) {
-                    std::cout << "[SET] ЧID: " << key << std::endl;
-                    server_->send(client_fd, "fail: ЧID\n");
-                    return;
-                }
+    // MGETһμȡȫkeyÿkeyظһУgetͬ
+    template<typename Reply>
+    void handle_mget(int client_fd, const ParsedCommand& command, Reply& reply) {
+        std::vector<std::string> keys;
+        std::string_view rest = command.rest;
+        std::string_view key;
+        while (next_token(rest, key)) {
+            keys.emplace_back(key);
+        }
+        LOG_DEBUG("[MGET] fd=" << client_fd << ", keys=" << keys.size());
+
+        auto results = storage_engine_.get_many(keys);
+        for (const auto& result : results) {
+            if (result.first) {
+                append_user(result.second, reply);
             }
             else {
-                // keyַΪname
-                result.second = User(-1, key);
+                reply += "fail\n";
             }
         }
+    }
 
-        // fieldûϢ
-        if (field == "name") {
-            result.second.name = value;
+    // MSETѶûͬһֶΪԵֵ
+    // УȫkeyֵÿƬһμԭ޸ģдʱκ޸
+    template<typename Reply>
+    void handle_mset(int client_fd, const ParsedCommand& command, Reply& reply) {
+        std::vector<std::string> keys;
+        std::vector<std::string_view> values;
+        std::string_view rest = command.rest;
+        std::string_view key;
+        std::string_view value;
+        while (next_token(rest, key) && next_token(rest, value)) {
+            keys.emplace_back(key);
+            values.push_back(value);
         }
-        else if (field == "email") {
-            result.second.email = value;
+        LOG_DEBUG("[MSET] fd=" << client_fd << ", field=" << command.field_name
+            << ", keys=" << keys.size());
+
+        if (command.field == UserField::UNKNOWN) {
+            reply += "fail: Чֶ\n";
+            return;
         }
-        else if (field == "phone") {
-            result.second.phone = value;
+
+        std::vector<long long> amounts;
+        if (command.field == UserField::CASH) {
+            amounts.resize(values.size());
         }
-        else if (field == "cash") {
-            try {
-                long long cash_change = std::stoll(value);
-                result.second.cash = cash_change;  // ý
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!valid_user_key(keys[i])) {
+                LOG_DEBUG("[MSET] ЧID: " << keys[i]);
+                reply += "fail: ЧID\n";
+                return;
             }
-            catch (const std::exception& e) {
-                std::cout << "[SET] ЧĽ: " << value << std::endl;
-                server_->send(client_fd, "fail: ЧĽ\n");
+            if (!amounts.empty() && !parse_integer(values[i], amounts[i])) {
+                LOG_DEBUG("[MSET] ЧĽ: " << values[i]);
+                reply += "fail: ЧĽ\n";
                 return;
             }
         }
+
+        auto results = storage_engine_.update_many(keys, [&](size_t i, User& user) {
+            switch (command.field) {
+            case UserField::NAME:
+                user.name = values[i];
+                break;
+            case UserField::EMAIL:
+                user.email = values[i];
+                break;
+            case UserField::PHONE:
+                user.phone = values[i];
+                break;
+            default:
+                user.cash = amounts[i];
+                break;
+            }
+            return true;
+        }, [&](size_t i, User& user) { return new_user(keys[i], user); });
+
+        bool stored = std::all_of(results.begin(), results.end(), [](StorageEngine::UpdateStatus status) {
+            return status == StorageEngine::UpdateStatus::UPDATED;
+        });
+        if (stored) {
+            reply += "ok\n";
+        }
         else {
-            std::cout << "[SET] Чֶ: " << field << std::endl;
-            server_->send(client_fd, "fail: Чֶ\n");
-            return;
+            reply += "fail: 洢ʧ\n";
         }
+    }
 
-        // 浽洢
-        bool success = storage_engine_.set(key, result.second);
+    // SET
+    template<typename Reply>
+    void handle_set(int client_fd, const ParsedCommand& command, Reply& reply) {
+        SetStatus status = update_user(client_fd, command.key, command.field,
+            command.field_name, command.value, nullptr);
 
-        if (success) {
-            server_->send(client_fd, "ok\n");
-            std::cout << "[SET] ɹ: key=" << key
-                << ", field=" << field << std::endl;
+        if (status == SetStatus::OK) {
+            reply += "ok\n";
         }
         else {
-            server_->send(client_fd, "fail: 洢ʧ\n");
-            std::cout << "[SET] 洢ʧ: key=" << key << std::endl;
+            reply += "fail: ";
+            reply += set_error_message(status);
+            reply += "\n";
         }
     }
 
-    // 
-    void process_command(int client_fd, const std::string& command) {
-        auto tokens = split(command, '/');
+    // INCRԭӵؼdeltaûʱظok/<>
+    template<typename Reply>
+    void handle_incr(int client_fd, const ParsedCommand& command, Reply& reply) {
+        LOG_DEBUG("[INCR] fd=" << client_fd << ", key=" << command.key
+            << ", delta=" << command.value);
 
-        if (tokens.size() < 2) {
-            std::cout << "[] Чʽ: " << command << std::endl;
-            server_->send(client_fd, "error: Чʽ\n");
+        long long delta = 0;
+        if (command.field != UserField::CASH) {
+            reply += "fail: Чֶ\n";
             return;
         }
+        if (!parse_integer(command.value, delta)) {
+            reply += "fail: ЧĽ\n";
+            return;
+        }
+
+        std::string_view key = command.key;
+        long long balance = 0;
+        auto status = storage_engine_.add_cash(std::string(key), delta, balance,
+            [key](User& user) { return new_user(key, user); });
+
+        switch (status) {
+        case StorageEngine::UpdateStatus::UPDATED:
+            reply += "ok/";
+            append_integer(reply, balance);
+            reply += "\n";
+            break;
+        case StorageEngine::UpdateStatus::NOT_FOUND:
+            reply += "fail: ЧID\n";
+            break;
+        case StorageEngine::UpdateStatus::REJECTED:
+            reply += "fail: \n";
+            break;
+        default:
+            reply += "fail: 洢ʧ\n";
+            break;
+        }
+    }
+
+    // CASexpectedʱΪvalueɹظok/<>
+    // ʱظfail/<ǰ>÷Ծݴ
+    template<typename Reply>
+    void handle_cas(int client_fd, const ParsedCommand& command, Reply& reply) {
+        LOG_DEBUG("[CAS] fd=" << client_fd << ", key=" << command.key
+            << ", expected=" << command.expected << ", value=" << command.value);
+
+        long long expected = 0;
+        long long desired = 0;
+        if (command.field != UserField::CASH) {
+            reply += "fail: Чֶ\n";
+            return;
+        }
+        if (!parse_integer(command.expected, expected) || !parse_integer(command.value, desired)) {
+            reply += "fail: ЧĽ\n";
+            return;
+        }
+
+        long long current = 0;
+        auto status = storage_engine_.compare_and_set_cash(std::string(command.key),
+            expected, desired, current);
+
+        switch (status) {
+        case StorageEngine::UpdateStatus::UPDATED:
+            reply += "ok/";
+            append_integer(reply, current);
+            reply += "\n";
+            break;
+        case StorageEngine::UpdateStatus::REJECTED:
+            reply += "fail/";
+            append_integer(reply, current);
+            reply += "\n";
+            break;
+        default:
+            reply += "fail\n";
+            break;
+        }
+    }
+
+    // һ֡
+    void handle_binary(int client_fd, const BinaryRequest& request, std::string& reply) {
+        switch (request.opcode) {
+        case OP_GET: {
+            auto result = lookup_user(client_fd, request.key);
+            if (!result.first) {
+                append_binary_status(reply, STATUS_NOT_FOUND, OP_GET);
+                break;
+            }
+            const User& user = result.second;
+            size_t frame_start = reply.size();
+            size_t length_pos = begin_binary_response(reply, STATUS_OK, OP_GET);
+            put_u32(reply, static_cast<uint32_t>(user.id));
+            put_u64(reply, static_cast<uint64_t>(user.cash));
+            if (!put_string16(reply, user.name) || !put_string16(reply, user.email) ||
+                !put_string16(reply, user.phone)) {
+                // ıЭͶSETдֶΣӦŲʱǽض
+                reply.resize(frame_start);
+                append_binary_status(reply, STATUS_TOO_LARGE, OP_GET, "ֶγ65535ֽ");
+                break;
+            }
+            finish_binary_response(reply, length_pos);
+            break;
+        }
+        case OP_SET: {
+            long long cash = 0;
+            const long long* cash_ptr = nullptr;
+            if (request.field == UserField::CASH) {
+                if (request.value.size() != 8) {
+                    append_binary_status(reply, STATUS_INVALID, OP_SET, "ЧĽ");
+                    break;
+                }
+                cash = static_cast<long long>(get_u64(request.value.data()));
+                cash_ptr = &cash;
+            }
+
+            SetStatus status = update_user(client_fd, request.key, request.field,
+                field_name(request.field), cash_ptr ? std::string_view() : request.value, cash_ptr);
+            if (status == SetStatus::OK) {
+                append_binary_status(reply, STATUS_OK, OP_SET);
+            }
+            else {
+                append_binary_status(reply,
+                    status == SetStatus::FAILED ? STATUS_FAILED : STATUS_INVALID,
+                    OP_SET, set_error_message(status));
+            }
+            break;
+        }
+        default:
+            LOG_DEBUG("[] δ֪ĶƲ: " << static_cast<int>(request.opcode));
+            append_binary_status(reply, STATUS_INVALID, request.opcode, "δ֪Ĳ");
+            break;
+        }
+    }
+
+    // δdataе֡÷֤dataֻ֡ظ׷ӵreply
+    // process_linesһڹ߳е
+    void process_frames(int client_fd, const char* data, size_t len, std::string& reply) {
+        size_t consumed = 0;
+        BinaryRequest request;
+        size_t frame_size = 0;
+        while (parse_binary_request(data + consumed, len - consumed, request, frame_size)
+               == FrameStatus::COMPLETE) {
+            handle_binary(client_fd, request, reply);
+            consumed += frame_size;
+        }
+    }
 
-        const std::string& cmd = tokens[0];
+    // '\n'֡δظ׷ӵreplyĲ´Ρ
+    // ֻʴ洢棨Դڹ߳е
+    template<typename Reply>
+    size_t process_lines(int client_fd, const char* data, size_t len, Reply& reply) {
+        size_t consumed = 0;
 
-        if (cmd == "get" && tokens.size() == 2) {
-            std::string key = tokens[1];
-            trim(key);
-            handle_get(client_fd, key);
+        while (consumed < len) {
+            const char* begin = data + consumed;
+            const char* end = static_cast<const char*>(memchr(begin, '\n', len - consumed));
+            if (!end) {
+                break;
+            }
+            consumed = end - data + 1;
+
+            execute(client_fd, begin, end - begin, reply);
         }
-        else if (cmd == "set" && tokens.size() == 4) {
-            std::string field = tokens[1];
-            std::string key = tokens[2];
-            std::string value = tokens[3];
 
-            trim(field);
-            trim(key);
-            trim(value);
+        return consumed;
+    }
 
-            handle_set(client_fd, field, key, value);
+    void process_batch(int client_fd, Protocol protocol, const char* data, size_t len, std::string& reply) {
+        if (protocol == Protocol::BINARY) {
+            process_frames(client_fd, data, len, reply);
         }
         else {
-            std::cout << "[] δ֪: " << command << std::endl;
-            std::stringstream help_msg;
-            help_msg << "error: δ֪\n"
-                << ":\n"
-                << "  get/<idname>              - ȡûϢ\n"
-                << "  set/<field>/<idname>/<value> - ûϢ\n"
-                << "ֶ(field)֧: name, email, phone, cash\n"
-                << "cashֶָ֧ʾȡ\n";
-            server_->send(client_fd, help_msg.str());
+            process_lines(client_fd, data, len, reply);
+        }
+    }
+
+    // 
+    template<typename Reply>
+    void process_command(int client_fd, const ParsedCommand& command, Reply& reply) {
+        switch (command.type) {
+        case CommandType::GET:
+            handle_get(client_fd, command.key, reply);
+            break;
+        case CommandType::SET:
+            handle_set(client_fd, command, reply);
+            break;
+        case CommandType::MGET:
+            handle_mget(client_fd, command, reply);
+            break;
+        case CommandType::MSET:
+            handle_mset(client_fd, command, reply);
+            break;
+        case CommandType::INCR:
+            handle_incr(client_fd, command, reply);
+            break;
+        case CommandType::CAS:
+            handle_cas(client_fd, command, reply);
+            break;
+        case CommandType::INVALID:
+            LOG_DEBUG("[] Чʽ: " << command.line);
+            reply += "error: Чʽ\n";
+            break;
+        default:
+            LOG_DEBUG("[] δ֪: " << command.line);
+            reply += "error: δ֪\n"
+                ":\n"
+                "  get/<idname>              - ȡûϢ\n"
+                "  set/<field>/<idname>/<value> - ûϢ\n"
+                "  mget/<key>/<key>/...        - ȡûϢ\n"
+                "  mset/<field>/<key>/<value>/<key>/<value>/... - ûϢ\n"
+                "  incr/cash/<idname>/<delta> - ԭӵ\n"
+                "  cas/cash/<idname>/<expected>/<value> - expectedʱΪvalue\n"
+                "ֶ(field)֧: name, email, phone, cash\n"
+                "cashֶָ֧ʾȡ\n";
+            break;
         }
     }
 
@@ -173,51 +460,197 @@ public:
     CommandHandler(NetworkServer* server, StorageEngine& storage)
         : server_(server), storage_engine_(storage) {}
 
-    void on_connected(int client_fd, const sockaddr_in& addr) override {
-        char ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
-        std::cout << "[] fd=" << client_fd
-            << ", IP=" << ip
-            << ", ˿=" << ntohs(addr.sin_port) << std::endl;
+    // keyܷûkeyintΧ
+    static bool valid_user_key(std::string_view key) {
+        if (!key.empty() && isdigit(static_cast<unsigned char>(key[0]))) {
+            long long id = 0;
+            return parse_integer(key, id) && id >= INT_MIN && id <= INT_MAX;
+        }
+        return true;
+    }
+
+    // ûʱkeyʹûkeyΪidΪname
+    // keyintΧʱfalse
+    static bool new_user(std::string_view key, User& user) {
+        if (!key.empty() && isdigit(static_cast<unsigned char>(key[0]))) {
+            long long id = 0;
+            if (!parse_integer(key, id) || id < INT_MIN || id > INT_MAX) {
+                return false;
+            }
+            user = User(static_cast<int>(id), "Ա");
+        }
+        else {
+            user = User(-1, std::string(key));
+        }
+        return true;
+    }
 
-        std::string welcome =
+    // ¸ʽto_chars/memcpyֱдظstd::stringӵOutputBuffer
+    // iostreamҲʱַ
+    static char* put_text(char* out, std::string_view text) {
+        memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+
+    template<typename Reply>
+    static void append_integer(Reply& reply, long long value) {
+        const size_t capacity = 20;   // long long20ַţ
+        char* begin = reply_reserve(reply, capacity);
+        char* end = std::to_chars(begin, begin + capacity, value).ptr;
+        reply_commit(reply, capacity, end - begin);
+    }
+
+    // ıЭû¼data/<id>/<name>/<email>/<phone>/<cash>
+    template<typename Reply>
+    static void append_user(const User& user, Reply& reply) {
+        // "data/"4'/''\n'id11ַcash20ַ
+        size_t capacity = 10 + 11 + 20 + user.name.size() + user.email.size() + user.phone.size();
+        char* begin = reply_reserve(reply, capacity);
+        char* p = put_text(begin, "data/");
+        p = std::to_chars(p, p + 11, user.id).ptr;
+        *p++ = '/';
+        p = put_text(p, user.name);
+        *p++ = '/';
+        p = put_text(p, user.email);
+        *p++ = '/';
+        p = put_text(p, user.phone);
+        *p++ = '/';
+        p = std::to_chars(p, p + 20, user.cash).ptr;
+        *p++ = '\n';
+        reply_commit(reply, capacity, p - begin);
+    }
+
+    static const char* welcome_message() {
+        return
             "ӭӵûϢ洢\n"
             ":\n"
             "  get/<idname>                     - ȡûϢ\n"
             "  set/<field>/<idname>/<value>     - ûϢ\n"
+            "  mget/<key>/<key>/...               - ȡûϢ\n"
+            "  mset/<field>/<key>/<value>/...     - ûϢ\n"
+            "  incr/cash/<idname>/<delta>       - ԭӵ\n"
+            "  cas/cash/<idname>/<expected>/<value> - expectedʱΪvalue\n"
             "ֶ(field)֧: name, email, phone, cash\n"
             "cashֶָ֧ʾȡ\n"
             "ʾ:\n"
             "  get/1001                    - ȡIDΪ1001ûϢ\n"
             "  get/john                    - ȡΪjohnûϢ\n"
             "  set/name/john/John Doe      - johnΪJohn Doe\n"
-            "  set/cash/1001/1000          - Ϊû10011000Ԫ\n"
-            "  set/cash/1001/-500          - û1001˻ȡ500Ԫ\n\n";
+            "  incr/cash/1001/1000         - Ϊû10011000Ԫ\n"
+            "  incr/cash/1001/-500         - û1001˻ȡ500Ԫ\n"
+            "  cas/cash/1001/500/0         - Ϊ500ʱ\n\n";
+    }
+
+    // ִһ'\n'ظ׷ӵreply
+    template<typename Reply>
+    void execute(int client_fd, const char* line, size_t len, Reply& reply) {
+        // ԭϽ
+        ParsedCommand command = parse_command(std::string_view(line, len));
+
+        if (command.line.empty()) {
+            return;
+        }
+
+        LOG_DEBUG("[] fd=" << client_fd
+            << ", : " << command.line);
+
+        // 
+        process_command(client_fd, command, reply);
+    }
+
+    void on_connected(int client_fd, const sockaddr_in& addr) override {
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        LOG_INFO("[] fd=" << client_fd
+            << ", IP=" << ip
+            << ", ˿=" << ntohs(addr.sin_port));
+
+        if (client_fd >= 0) {
+            if (static_cast<size_t>(client_fd) >= protocols_.size()) {
+                protocols_.resize(client_fd + 1, Protocol::UNKNOWN);
+            }
+            protocols_[client_fd] = Protocol::UNKNOWN;
+        }
 
         if (server_) {
-            server_->send(client_fd, welcome);
+            server_->send(client_fd, welcome_message());
         }
     }
 
-    void on_data(int client_fd, const char* data, size_t len) override {
-        std::string command(data, len);
+    size_t on_data(int client_fd, const char* data, size_t len) override {
+        // һֽھӵЭ
+        size_t skipped = 0;
+        Protocol protocol = Protocol::TEXT;
+        if (client_fd >= 0 && static_cast<size_t>(client_fd) < protocols_.size()) {
+            Protocol& state = protocols_[client_fd];
+            if (state == Protocol::UNKNOWN && len > 0) {
+                if (static_cast<uint8_t>(data[0]) == BINARY_MAGIC) {
+                    state = Protocol::BINARY;
+                    skipped = 1;
+                }
+                else {
+                    state = Protocol::TEXT;
+                }
+            }
+            protocol = state;
+        }
+        data += skipped;
+        len -= skipped;
 
-        // Ƴβհַ
-        trim(command);
+        // ֻ/֡´
+        size_t complete;
+        if (protocol == Protocol::BINARY) {
+            complete = complete_binary_frames(data, len);
+            if (complete == SIZE_MAX) {
+                LOG_WARN("[] fd=" << client_fd << " ֡Ͽ");
+                if (server_) {
+                    server_->disconnect(client_fd);
+                }
+                return skipped + len;
+            }
+        }
+        else {
+            const char* last = static_cast<const char*>(memrchr(data, '\n', len));
+            complete = last ? last - data + 1 : 0;
+        }
+        if (complete == 0) {
+            return skipped;
+        }
 
-        if (command.empty()) {
-            return;
+        if (server_ && server_->has_workers()) {
+            // ߳ģʽ¼ѭֻгִн߳
+            std::string batch(data, complete);
+            bool submitted = server_->offload(client_fd, [this, client_fd, protocol, batch = std::move(batch)]() {
+                std::string reply;
+                process_batch(client_fd, protocol, batch.data(), batch.size(), reply);
+                return reply;
+            });
+            if (!submitted) {
+                // ̶߳뻺Ժµon_data
+                return skipped;
+            }
+            return skipped + complete;
         }
 
-        std::cout << "[] fd=" << client_fd
-            << ", : " << command << std::endl;
+        // ıЭĻظֱдӵ
+        OutputBuffer* output = server_ && protocol == Protocol::TEXT
+            ? server_->output_buffer(client_fd) : nullptr;
+        if (output) {
+            process_lines(client_fd, data, complete, *output);
+            server_->commit_output(client_fd);
+            return skipped + complete;
+        }
 
-        // 
-        process_command(client_fd, command);
+        std::string reply;
+        process_batch(client_fd, protocol, data, complete, reply);
+        if (server_ && !reply.empty()) {
+            server_->send(client_fd, reply);
+        }
+        return skipped + complete;
     }
 
     void on_closed(int client_fd) override {
-        std::cout << "[Ͽ] fd=" << client_fd << std::endl;
+        LOG_INFO("[Ͽ] fd=" << client_fd);
     }
 
     bool send_data(int client_fd, const char* data, size_t len) override {
@@ -230,4 +663,36 @@ public:
     void set_server(NetworkServer* server) {
         server_ = server;
     }
-};
\ No newline at end of file
+};
+
+#ifdef HAVE_COROUTINES
+// CommandHandlerЭ̰汾ÿһỰжȡظ
+inline CoroTask command_session(CoroConnection& conn, CommandHandler& commands) {
+    co_await conn.write(CommandHandler::welcome_message());
+
+    std::string reply;
+    while (auto line = co_await conn.read_line()) {
+        reply.clear();
+        commands.execute(conn.fd(), line->data(), line->size(), reply);
+        if (!reply.empty()) {
+            co_await conn.write(reply);
+        }
+    }
+}
+
+// Э̻ỰCommandHandlerӴ
+class CoroCommandHandler : public CoroHandler {
+private:
+    CommandHandler commands_;
+
+public:
+    CoroCommandHandler(NetworkServer* server, StorageEngine& storage)
+        : CoroHandler(server, [this](CoroConnection& conn) { return command_session(conn, commands_); }),
+          commands_(server, storage) {}
+
+    void on_closed(int client_fd) override {
+        commands_.on_closed(client_fd);
+        CoroHandler::on_closed(client_fd);
+    }
+};
+#endif
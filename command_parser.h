@@ -0,0 +1,234 @@
+//command_parser.h
+#pragma once
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+
+// 文本协议命令解析：在连接缓冲区上原地切分，结果都是指向原数据的string_view，不分配内存。
+//   get/<key>
+//   set/<field>/<key>/<value>
+//   mget/<key>/<key>/...
+//   mset/<field>/<key>/<value>/<key>/<value>/...
+//   incr/<field>/<key>/<delta>
+//   cas/<field>/<key>/<expected>/<value>
+// 以'/'分隔，空字段被跳过（"get//1001"等同于"get/1001"），参数去掉首尾空格。
+
+enum class CommandType {
+    INVALID,    // 不足两个字段
+    UNKNOWN,    // 未知命令或参数个数不对
+    GET,
+    SET,
+    MGET,
+    MSET,
+    INCR,
+    CAS
+};
+
+// set命令可以修改的字段
+enum class UserField {
+    UNKNOWN,
+    NAME,
+    EMAIL,
+    PHONE,
+    CASH
+};
+
+struct ParsedCommand {
+    CommandType type = CommandType::INVALID;
+    UserField field = UserField::UNKNOWN;
+    std::string_view line;          // 去掉首尾空白后的整行，用于日志和错误信息
+    std::string_view field_name;
+    std::string_view key;
+    std::string_view value;
+    std::string_view expected;      // cas：期望的旧值
+    std::string_view rest;          // mget/mset：key（或key/value对）部分，用next_token逐个取出
+};
+
+struct CommandEntry {
+    std::string_view name;
+    CommandType type;
+    size_t tokens;                  // 包括命令名在内的字段数
+    bool variadic;                  // 为true时tokens是最少字段数，之后的参数可以重复
+};
+
+struct FieldEntry {
+    std::string_view name;
+    UserField field;
+};
+
+// 编译期的命令表和字段表，新增命令或字段只需在这里加一行
+inline constexpr CommandEntry COMMAND_TABLE[] = {
+    { "get",  CommandType::GET,  2, false },
+    { "set",  CommandType::SET,  4, false },
+    { "mget", CommandType::MGET, 2, true },
+    { "mset", CommandType::MSET, 4, true },
+    { "incr", CommandType::INCR, 4, false },
+    { "cas",  CommandType::CAS,  5, false },
+};
+
+inline constexpr FieldEntry FIELD_TABLE[] = {
+    { "name",  UserField::NAME },
+    { "email", UserField::EMAIL },
+    { "phone", UserField::PHONE },
+    { "cash",  UserField::CASH },
+};
+
+constexpr const CommandEntry* find_command(std::string_view name) {
+    for (const CommandEntry& entry : COMMAND_TABLE) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+constexpr UserField find_field(std::string_view name) {
+    for (const FieldEntry& entry : FIELD_TABLE) {
+        if (entry.name == name) {
+            return entry.field;
+        }
+    }
+    return UserField::UNKNOWN;
+}
+
+constexpr std::string_view field_name(UserField field) {
+    for (const FieldEntry& entry : FIELD_TABLE) {
+        if (entry.field == field) {
+            return entry.name;
+        }
+    }
+    return std::string_view();
+}
+
+static_assert(find_command("set")->type == CommandType::SET, "命令表错误");
+static_assert(find_field("cash") == UserField::CASH, "字段表错误");
+static_assert(find_field("id") == UserField::UNKNOWN, "字段表错误");
+
+// 去掉首尾的空格和'\r'
+constexpr std::string_view trim_line(std::string_view s) {
+    size_t begin = 0;
+    size_t end = s.size();
+    while (begin < end && (s[begin] == ' ' || s[begin] == '\r')) begin++;
+    while (end > begin && (s[end - 1] == ' ' || s[end - 1] == '\r')) end--;
+    return s.substr(begin, end - begin);
+}
+
+// 去掉首尾空格
+constexpr std::string_view trim_spaces(std::string_view s) {
+    size_t begin = 0;
+    size_t end = s.size();
+    while (begin < end && s[begin] == ' ') begin++;
+    while (end > begin && s[end - 1] == ' ') end--;
+    return s.substr(begin, end - begin);
+}
+
+// 解析一行命令（不含'\n'）。line为空时返回type为INVALID、line为空的结果
+constexpr ParsedCommand parse_command(std::string_view line) {
+    ParsedCommand result;
+    result.line = trim_line(line);
+
+    // 最多保存5个字段，多出的只计数；ends[i]为第i个字段之后的位置
+    std::string_view tokens[5];
+    size_t ends[5] = {};
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < result.line.size()) {
+        size_t slash = result.line.find('/', pos);
+        if (slash == std::string_view::npos) {
+            slash = result.line.size();
+        }
+        if (slash > pos) {
+            if (count < 5) {
+                tokens[count] = result.line.substr(pos, slash - pos);
+                ends[count] = slash;
+            }
+            count++;
+        }
+        pos = slash + 1;
+    }
+
+    if (count < 2) {
+        result.type = CommandType::INVALID;
+        return result;
+    }
+
+    const CommandEntry* entry = find_command(tokens[0]);
+    bool arity_ok = entry && (entry->variadic ? count >= entry->tokens : count == entry->tokens);
+    // mset的key/value必须成对
+    if (arity_ok && entry->type == CommandType::MSET && count % 2 != 0) {
+        arity_ok = false;
+    }
+    if (!arity_ok) {
+        result.type = CommandType::UNKNOWN;
+        return result;
+    }
+
+    result.type = entry->type;
+    switch (entry->type) {
+    case CommandType::GET:
+        result.key = trim_spaces(tokens[1]);
+        break;
+    case CommandType::SET:
+    case CommandType::INCR:
+        result.field_name = trim_spaces(tokens[1]);
+        result.field = find_field(result.field_name);
+        result.key = trim_spaces(tokens[2]);
+        result.value = trim_spaces(tokens[3]);
+        break;
+    case CommandType::CAS:
+        result.field_name = trim_spaces(tokens[1]);
+        result.field = find_field(result.field_name);
+        result.key = trim_spaces(tokens[2]);
+        result.expected = trim_spaces(tokens[3]);
+        result.value = trim_spaces(tokens[4]);
+        break;
+    case CommandType::MGET:
+        result.rest = result.line.substr(ends[0]);
+        break;
+    default:
+        result.field_name = trim_spaces(tokens[1]);
+        result.field = find_field(result.field_name);
+        result.rest = result.line.substr(ends[1]);
+        break;
+    }
+    return result;
+}
+
+// 从rest中取出下一个非空字段（去掉首尾空格），没有更多字段时返回false
+constexpr bool next_token(std::string_view& rest, std::string_view& token) {
+    while (!rest.empty()) {
+        size_t slash = rest.find('/');
+        std::string_view part = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+        if (!part.empty()) {
+            token = trim_spaces(part);
+            return true;
+        }
+    }
+    return false;
+}
+
+static_assert(parse_command("get//1001 \r").key == "1001", "解析错误");
+static_assert(parse_command("set/ cash /1001/-500").field == UserField::CASH, "解析错误");
+static_assert(parse_command("get/1/2").type == CommandType::UNKNOWN, "解析错误");
+static_assert(parse_command("get").type == CommandType::INVALID, "解析错误");
+static_assert(parse_command("mget/1/2/3").rest == "/1/2/3", "解析错误");
+static_assert(parse_command("mset/cash/1/2/3").type == CommandType::UNKNOWN, "解析错误");
+static_assert(parse_command("incr/cash/1001/-50").value == "-50", "解析错误");
+static_assert(parse_command("cas/cash/1001/100/200").expected == "100", "解析错误");
+static_assert(parse_command("cas/cash/1001/100").type == CommandType::UNKNOWN, "解析错误");
+
+// 解析整数，语义与std::stoll一致：跳过前导空白，允许'+'/'-'，只解析开头的数字部分。
+// 没有数字或超出范围时返回false
+inline bool parse_integer(std::string_view s, long long& value) {
+    size_t pos = 0;
+    while (pos < s.size() && isspace(static_cast<unsigned char>(s[pos]))) pos++;
+    if (pos < s.size() && s[pos] == '+' &&
+        (pos + 1 >= s.size() || s[pos + 1] != '-')) {
+        pos++;
+    }
+    auto result = std::from_chars(s.data() + pos, s.data() + s.size(), value);
+    return result.ec == std::errc();
+}
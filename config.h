@@ -1,4 +1,7 @@
 #pragma once
+#include "key_hash.h"
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 class User {
@@ -24,13 +27,16 @@ public:
     // LRU˫ָ
     DataNode* lru_prev = nullptr;
     DataNode* lru_next = nullptr;
+    // CLOCK̭λ߳ڹλ
+    std::atomic<bool> referenced{false};
 
     std::string key;     // 
     User value;          // ֵ
+    uint64_t hash;       // keyĹϣֵhash_keyʱһΣϣݺͱȽʱֱʹ
     int hash_index = -1; // ڹϣеλãڿɾ
 
     DataNode(const std::string& k, const User& v)
-        : key(k), value(v) {}
+        : key(k), value(v), hash(hash_key(k)) {}
 
     // ָ
     void reset() {
@@ -0,0 +1,428 @@
+//coro.h
+#pragma once
+#include "client.h"
+
+#ifdef HAVE_COROUTINES
+#include <coroutine>
+#include <optional>
+#include <string_view>
+#include <cstring>
+
+// C++20协程连接接口：每个连接一个会话协程，在事件循环线程中运行
+//
+//     CoroTask session(CoroConnection& conn) {
+//         co_await conn.write("hello\n");
+//         while (auto line = co_await conn.read_line()) {
+//             co_await conn.loop().sleep(10);
+//             co_await conn.write(*line);
+//         }
+//     }
+//
+// 会话协程的第一个参数必须是CoroConnection&，协程帧从该连接所属事件循环的FramePool分配。
+// 会话结束时连接被关闭；连接被对端关闭时read_line返回nullopt。
+
+class CoroConnection;
+class CoroHandler;
+
+// 协程帧内存池：按64字节分级的空闲链表，只在所属事件循环线程中使用
+class FramePool {
+private:
+    static const size_t GRANULE = 64;
+    static const size_t MAX_POOLED = 4096;    // 更大的帧直接用operator new
+    static const size_t NUM_CLASSES = MAX_POOLED / GRANULE;
+
+    // 放在每块内存前面，释放时据此找回所属的池和大小级别
+    struct alignas(16) Header {
+        FramePool* pool;
+        size_t size_class;
+    };
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    FreeNode* free_lists_[NUM_CLASSES] = {};
+
+public:
+    FramePool() = default;
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    ~FramePool() {
+        for (size_t i = 0; i < NUM_CLASSES; i++) {
+            FreeNode* node = free_lists_[i];
+            while (node) {
+                FreeNode* next = node->next;
+                ::operator delete(node);
+                node = next;
+            }
+        }
+    }
+
+    // pool为nullptr时退化为普通的operator new
+    static void* allocate(FramePool* pool, size_t size) {
+        size_t total = size + sizeof(Header);
+        size_t size_class = (total + GRANULE - 1) / GRANULE;
+
+        void* block = nullptr;
+        if (pool && size_class <= NUM_CLASSES) {
+            FreeNode*& head = pool->free_lists_[size_class - 1];
+            if (head) {
+                block = head;
+                head = head->next;
+            } else {
+                block = ::operator new(size_class * GRANULE);
+            }
+        } else {
+            pool = nullptr;
+            block = ::operator new(total);
+        }
+
+        Header* header = static_cast<Header*>(block);
+        header->pool = pool;
+        header->size_class = size_class;
+        return header + 1;
+    }
+
+    static void deallocate(void* ptr) {
+        Header* header = static_cast<Header*>(ptr) - 1;
+        FramePool* pool = header->pool;
+        if (pool) {
+            FreeNode* node = reinterpret_cast<FreeNode*>(header);
+            FreeNode*& head = pool->free_lists_[header->size_class - 1];
+            node->next = head;
+            head = node;
+        } else {
+            ::operator delete(header);
+        }
+    }
+};
+
+// 会话协程的返回类型：创建后立即运行，结束时自动释放协程帧并关闭连接
+class CoroTask {
+public:
+    struct promise_type {
+        CoroConnection* conn = nullptr;
+
+        promise_type() = default;
+
+        template<typename... Args>
+        promise_type(CoroConnection& connection, Args&&...) : conn(&connection) {}
+
+        template<typename... Args>
+        static void* operator new(size_t size, CoroConnection& connection, Args&&...);
+
+        static void* operator new(size_t size) {
+            return FramePool::allocate(nullptr, size);
+        }
+
+        static void operator delete(void* ptr) {
+            FramePool::deallocate(ptr);
+        }
+
+        CoroTask get_return_object();
+
+        std::suspend_never initial_suspend() noexcept { return {}; }
+
+        // 先释放协程帧，再通知连接会话已经结束
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+            void await_resume() const noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            try {
+                throw;
+            }
+            catch (const std::exception& e) {
+                LOG_ERROR("会话协程异常: " << e.what());
+            }
+            catch (...) {
+                LOG_ERROR("会话协程异常");
+            }
+        }
+    };
+};
+
+// 协程视角的连接
+class CoroConnection {
+    friend class CoroHandler;
+    friend struct CoroTask::promise_type;
+
+private:
+    CoroHandler* handler_ = nullptr;
+    NetworkServer* server_ = nullptr;
+    FramePool* pool_ = nullptr;
+    int fd_ = -1;
+
+    std::coroutine_handle<> session_;  // 会话协程，未结束时有效
+    std::coroutine_handle<> reader_;   // 挂起在read_line上的协程
+
+    // on_data期间直接读取服务器的输入缓冲区，不拷贝
+    const char* view_data_ = nullptr;
+    size_t view_size_ = 0;
+    size_t view_pos_ = 0;
+
+    // 跨事件保留的数据（半行，或协程没在等待读取时到达的数据）
+    InputBuffer input_{1024};
+    size_t input_consumed_ = 0;        // 已作为行返回、下次read_line时丢弃的字节数
+
+    bool closed_ = false;
+    bool done_ = false;                // 会话协程已结束
+    bool busy_ = false;                // 正在回调中，延后回收
+
+    void reset(int fd) {
+        fd_ = fd;
+        session_ = nullptr;
+        reader_ = nullptr;
+        view_data_ = nullptr;
+        view_size_ = view_pos_ = 0;
+        input_.clear();
+        input_consumed_ = 0;
+        closed_ = false;
+        done_ = false;
+        busy_ = false;
+    }
+
+    // 取出下一行，返回的视图在下一次调用前有效
+    bool next_line(std::string_view& line) {
+        if (view_data_) {
+            const char* begin = view_data_ + view_pos_;
+            const char* end = static_cast<const char*>(memchr(begin, '\n', view_size_ - view_pos_));
+            if (!end) return false;
+            line = std::string_view(begin, end - begin);
+            view_pos_ = end - view_data_ + 1;
+            return true;
+        }
+
+        input_.consume(input_consumed_);
+        input_consumed_ = 0;
+        const char* begin = input_.data();
+        const char* end = static_cast<const char*>(memchr(begin, '\n', input_.size()));
+        if (!end) return false;
+        line = std::string_view(begin, end - begin);
+        input_consumed_ = end - begin + 1;
+        return true;
+    }
+
+public:
+    struct LineAwaiter {
+        CoroConnection* conn;
+        std::string_view line;
+        bool ready = false;
+
+        bool await_ready() {
+            ready = conn->next_line(line);
+            return ready || conn->closed_;
+        }
+        void await_suspend(std::coroutine_handle<> handle) {
+            conn->reader_ = handle;
+        }
+        std::optional<std::string_view> await_resume() {
+            if (!ready) {
+                ready = conn->next_line(line);
+            }
+            if (ready) return line;
+            return std::nullopt;
+        }
+    };
+
+    struct WriteAwaiter {
+        bool ok;
+
+        bool await_ready() const noexcept { return true; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        bool await_resume() const noexcept { return ok; }
+    };
+
+    // 读取一行（不含'\n'），连接关闭且没有剩余完整行时返回nullopt；
+    // 返回的string_view只在下一次co_await之前有效
+    LineAwaiter read_line() { return LineAwaiter{this, {}, false}; }
+
+    // 写入输出缓冲区，本轮事件处理结束后与其他输出合并发送，不会挂起；
+    // 输出积压由服务器的高水位控制（暂停读取）。连接已关闭时返回false
+    WriteAwaiter write(std::string_view data) {
+        bool ok = !closed_ && server_->send(fd_, data.data(), data.size());
+        return WriteAwaiter{ok};
+    }
+
+    int fd() const { return fd_; }
+    bool closed() const { return closed_; }
+    EventLoop& loop() { return *server_->event_loop_; }
+};
+
+// 把ConnectionHandler回调转换为协程的恢复：每个连接启动一个session协程
+class CoroHandler : public ConnectionHandler {
+public:
+    using Session = std::function<CoroTask(CoroConnection&)>;
+
+private:
+    NetworkServer* server_;
+    Session session_;
+    FramePool pool_;
+    std::vector<CoroConnection*> connections_;  // fd -> 连接
+    std::vector<CoroConnection*> free_;         // 可复用的连接对象
+    std::vector<CoroConnection*> all_;
+
+    CoroConnection* find(int fd) const {
+        if (fd < 0 || static_cast<size_t>(fd) >= connections_.size()) {
+            return nullptr;
+        }
+        return connections_[fd];
+    }
+
+    void detach(CoroConnection* conn) {
+        if (find(conn->fd_) == conn) {
+            connections_[conn->fd_] = nullptr;
+        }
+        conn->closed_ = true;
+    }
+
+    // 连接已关闭且会话已结束时回收
+    void maybe_release(CoroConnection* conn) {
+        if (conn->closed_ && conn->done_ && !conn->busy_) {
+            free_.push_back(conn);
+        }
+    }
+
+    void resume_reader(CoroConnection* conn) {
+        std::coroutine_handle<> reader = conn->reader_;
+        conn->reader_ = nullptr;
+        reader.resume();
+    }
+
+public:
+    CoroHandler(NetworkServer* server, Session session)
+        : server_(server), session_(std::move(session)) {}
+
+    ~CoroHandler() override {
+        // 销毁仍挂起的会话（例如在sleep中），协程帧要在pool_之前释放
+        for (CoroConnection* conn : all_) {
+            if (!conn->done_ && conn->session_) {
+                conn->session_.destroy();
+            }
+            delete conn;
+        }
+    }
+
+    void on_connected(int client_fd, const sockaddr_in& /*addr*/) override {
+        CoroConnection* conn;
+        if (!free_.empty()) {
+            conn = free_.back();
+            free_.pop_back();
+        } else {
+            conn = new CoroConnection();
+            all_.push_back(conn);
+        }
+        conn->handler_ = this;
+        conn->server_ = server_;
+        conn->pool_ = &pool_;
+        conn->reset(client_fd);
+
+        if (static_cast<size_t>(client_fd) >= connections_.size()) {
+            connections_.resize(client_fd + 1, nullptr);
+        }
+        connections_[client_fd] = conn;
+
+        conn->busy_ = true;
+        session_(*conn);
+        conn->busy_ = false;
+        maybe_release(conn);
+    }
+
+    size_t on_data(int client_fd, const char* data, size_t len) override {
+        CoroConnection* conn = find(client_fd);
+        if (!conn) {
+            return len;
+        }
+
+        conn->busy_ = true;
+        bool has_line = memchr(data, '\n', len) != nullptr;
+
+        if (conn->reader_ && has_line && conn->input_.size() == conn->input_consumed_) {
+            // 没有残留数据：协程直接在服务器的缓冲区上读取各行
+            conn->input_.clear();
+            conn->input_consumed_ = 0;
+            conn->view_data_ = data;
+            conn->view_size_ = len;
+            conn->view_pos_ = 0;
+
+            resume_reader(conn);
+
+            if (!conn->done_ && conn->view_pos_ < len) {
+                conn->input_.append(data + conn->view_pos_, len - conn->view_pos_);
+            }
+            conn->view_data_ = nullptr;
+        } else {
+            conn->input_.consume(conn->input_consumed_);
+            conn->input_consumed_ = 0;
+            conn->input_.append(data, len);
+            if (conn->reader_ && has_line) {
+                resume_reader(conn);
+            }
+        }
+
+        conn->busy_ = false;
+        maybe_release(conn);
+        return len;
+    }
+
+    void on_closed(int client_fd) override {
+        CoroConnection* conn = find(client_fd);
+        if (!conn) {
+            return;
+        }
+
+        detach(conn);
+        conn->busy_ = true;
+        if (conn->reader_) {
+            resume_reader(conn);
+        }
+        conn->busy_ = false;
+        maybe_release(conn);
+    }
+
+    bool send_data(int client_fd, const char* data, size_t len) override {
+        return server_->send(client_fd, data, len);
+    }
+
+    // 会话协程结束（协程帧已释放）
+    void session_finished(CoroConnection* conn) {
+        conn->done_ = true;
+        conn->session_ = nullptr;
+        conn->reader_ = nullptr;
+        if (!conn->closed_) {
+            detach(conn);
+            server_->disconnect(conn->fd_);
+        }
+        maybe_release(conn);
+    }
+};
+
+template<typename... Args>
+inline void* CoroTask::promise_type::operator new(size_t size, CoroConnection& connection, Args&&...) {
+    return FramePool::allocate(connection.pool_, size);
+}
+
+inline CoroTask CoroTask::promise_type::get_return_object() {
+    if (conn) {
+        conn->session_ = std::coroutine_handle<promise_type>::from_promise(*this);
+    }
+    return CoroTask{};
+}
+
+inline void CoroTask::promise_type::FinalAwaiter::await_suspend(
+    std::coroutine_handle<promise_type> handle) noexcept {
+    CoroConnection* conn = handle.promise().conn;
+    handle.destroy();
+    if (conn) {
+        conn->handler_->session_finished(conn);
+    }
+}
+
+#endif
@@ -1,26 +1,120 @@
 #pragma once
 #include "config.h"
-#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
 
 class IntrusiveHashTable {
+public:
+    // 每次insert/remove默认搬迁的旧桶数。扩容后至少还要插入0.75×旧容量个节点才会再次扩容，
+    // 每次搬2个桶保证在那之前搬完；再大只会让搬迁期间的单次操作更慢
+    static const int DEFAULT_REHASH_STEP = 2;
+    // 服务器在事件循环定时器中调用rehash()时每次搬迁的旧桶数（桶数组的8页），见BasicStorageEngine::rehash
+    static const int IDLE_REHASH_STEP = 4096;
+
 private:
-    std::vector<DataNode*> buckets;
+    // 桶数组用calloc分配：大数组直接来自全零的新页，扩容时不用先把整个新数组清零
+    struct FreeDeleter {
+        void operator()(DataNode** p) const { std::free(p); }
+    };
+    using Buckets = std::unique_ptr<DataNode*[], FreeDeleter>;
+
+    Buckets buckets;
     int capacity;
     int size;
     double load_factor = 0.75;
 
+    // 渐进式扩容：扩容时旧桶数组留在old_buckets中，之后每次insert/remove把rehash_step个旧桶
+    // 搬到新数组，搬完为止，避免一次性rehash全部节点造成的停顿。搬迁期间查找要查两个数组，新节点只进新数组
+    Buckets old_buckets;
+    int old_capacity = 0;
+    int rehash_index = 0;     // 下一个要搬的旧桶
+    int rehash_step = DEFAULT_REHASH_STEP;  // 每次操作搬迁的旧桶数，0表示扩容时一次搬完
+    // 新数组来自calloc的新页，第一次写入某页时缺页，扩容后随机位置的插入几乎每次都落在没写过的页上。
+    // 调用rehash()时，节点数超过扩容阈值的一半后提前分配下一次扩容用的数组，逐页写一遍，
+    // resize时直接换上，缺页发生在rehash()里而不是请求上
+    Buckets next_buckets;
+    int next_capacity = 0;
+    int prefault_index = 0;   // next_buckets中下一个要写的桶
+
     // ��ϣ����
-    unsigned int hash(const std::string& key) {
-        unsigned int hash = 5381;
-        for (char c : key) {
-            hash = ((hash << 5) + hash) + c; // hash * 33 + c
+    // 桶数总是2的幂，用掩码代替取模；哈希值来自DataNode::hash或hash_key
+    static unsigned int index_of(uint64_t hash, int cap) {
+        return static_cast<unsigned int>(hash & static_cast<uint64_t>(cap - 1));
+    }
+
+    static int round_up(int n) {
+        int cap = 1;
+        while (cap < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    static Buckets allocate(int n) {
+        return Buckets(static_cast<DataNode**>(std::calloc(n, sizeof(DataNode*))));
+    }
+
+    // 返回指向key所在节点的链接（桶头或前一个节点的hash_next），不存在返回nullptr。
+    // 先比较缓存的哈希值，只有相等时才比较key
+    DataNode** find_link(DataNode** table, int cap, const std::string& key, uint64_t hash) const {
+        DataNode** link = &table[index_of(hash, cap)];
+        while (*link) {
+            if ((*link)->hash == hash && (*link)->key == key) {
+                return link;
+            }
+            link = &(*link)->hash_next;
+        }
+        return nullptr;
+    }
+
+    // 先查新数组，再查还没搬完的旧数组
+    DataNode** find_link(const std::string& key, uint64_t hash) const {
+        DataNode** link = find_link(buckets.get(), capacity, key, hash);
+        if (!link && old_buckets) {
+            link = find_link(old_buckets.get(), old_capacity, key, hash);
+        }
+        return link;
+    }
+
+    // 从prefault_index起写next_buckets中count个桶所在的页（每页写一个桶，值不变）
+    void prefault(int count) {
+        const int per_page = 4096 / static_cast<int>(sizeof(DataNode*));
+        int end = std::min(next_capacity, prefault_index + count);
+        for (; prefault_index < end; prefault_index += per_page) {
+            DataNode* volatile* slot = &next_buckets[prefault_index];
+            *slot = *slot;
+        }
+    }
+
+    // 把最多count个旧桶搬到新数组，全部搬完后释放旧数组
+    void migrate(int count) {
+        while (old_buckets && count-- > 0) {
+            DataNode* node = old_buckets[rehash_index];
+            while (node) {
+                DataNode* next = node->hash_next;
+                unsigned int index = index_of(node->hash, capacity);
+                node->hash_index = index;
+
+                // ���뵽��Ͱ
+                node->hash_next = buckets[index];
+                buckets[index] = node;
+
+                node = next;
+            }
+            old_buckets[rehash_index] = nullptr;
+
+            if (++rehash_index >= old_capacity) {
+                old_buckets.reset();
+                old_capacity = 0;
+                rehash_index = 0;
+            }
         }
-        return hash % capacity;
     }
 
 public:
-    IntrusiveHashTable(int cap = 16) : capacity(cap), size(0) {
-        buckets.resize(capacity, nullptr);
+    IntrusiveHashTable(int cap = 16) : capacity(round_up(cap)), size(0) {
+        buckets = allocate(capacity);
     }
 
     ~IntrusiveHashTable() {
@@ -32,36 +126,29 @@ public:
     DataNode* insert(DataNode* node) {
         if (!node) return nullptr;
 
-        unsigned int index = hash(node->key);
-        node->hash_index = index;
-
-        DataNode* current = buckets[index];
-        DataNode* prev = nullptr;
+        migrate(rehash_step);
 
         // �����Ƿ��Ѵ�����ͬkey
-        while (current) {
-            if (current->key == node->key) {
-                // �滻���нڵ�
-                node->hash_next = current->hash_next;
-                if (prev) {
-                    prev->hash_next = node;
-                }
-                else {
-                    buckets[index] = node;
-                }
-                return current; // ���ر��滻�Ľڵ�
-            }
-            prev = current;
-            current = current->hash_next;
+        DataNode** link = find_link(node->key, node->hash);
+        if (link) {
+            // �滻���нڵ�
+            DataNode* current = *link;
+            node->hash_next = current->hash_next;
+            node->hash_index = current->hash_index;
+            *link = node;
+            return current; // ���ر��滻�Ľڵ�
         }
 
+        unsigned int index = index_of(node->hash, capacity);
+        node->hash_index = index;
+
         // ���뵽����ͷ��
         node->hash_next = buckets[index];
         buckets[index] = node;
         size++;
 
         // ����Ƿ���Ҫ����
-        if (size > capacity * load_factor) {
+        if (size > capacity * load_factor && !old_buckets) {
             resize(capacity * 2);
         }
 
@@ -69,77 +156,83 @@ public:
     }
 
     // ���ҽڵ�
-    DataNode* find(const std::string& key) {
-        unsigned int index = hash(key);
-        DataNode* node = buckets[index];
-
-        while (node) {
-            if (node->key == key) {
-                return node;
-            }
-            node = node->hash_next;
-        }
-        return nullptr;
+    // 查找不搬迁旧桶：CLOCK策略下查找只持有共享锁，不能修改表
+    DataNode* find(const std::string& key) const {
+        DataNode** link = find_link(key, hash_key(key));
+        return link ? *link : nullptr;
     }
 
     // ɾ���ڵ�
     DataNode* remove(const std::string& key) {
-        unsigned int index = hash(key);
-        DataNode* node = buckets[index];
-        DataNode* prev = nullptr;
-
-        while (node) {
-            if (node->key == key) {
-                if (prev) {
-                    prev->hash_next = node->hash_next;
-                }
-                else {
-                    buckets[index] = node->hash_next;
-                }
-                node->hash_next = nullptr;
-                node->hash_index = -1;
-                size--;
-                return node;
-            }
-            prev = node;
-            node = node->hash_next;
+        migrate(rehash_step);
+
+        DataNode** link = find_link(key, hash_key(key));
+        if (!link) {
+            return nullptr;
         }
-        return nullptr;
+
+        DataNode* node = *link;
+        *link = node->hash_next;
+        node->hash_next = nullptr;
+        node->hash_index = -1;
+        size--;
+        return node;
     }
 
     // ����
+    // 开始扩容到new_capacity个桶，旧桶在之后的操作中逐步搬迁；上一次扩容还没搬完的先搬完
     void resize(int new_capacity) {
-        std::vector<DataNode*> new_buckets(new_capacity, nullptr);
-        int old_capacity = capacity;
-        capacity = new_capacity;
-
-        for (int i = 0; i < old_capacity; i++) {
-            DataNode* node = buckets[i];
-            while (node) {
-                DataNode* next = node->hash_next;
-                unsigned int new_index = hash(node->key);
-                node->hash_index = new_index;
+        migrate(old_capacity);
+
+        old_buckets = std::move(buckets);
+        old_capacity = capacity;
+        rehash_index = 0;
+        capacity = round_up(new_capacity);
+        buckets = next_buckets && next_capacity == capacity ? std::move(next_buckets) : allocate(capacity);
+        next_buckets.reset();
+        next_capacity = 0;
+
+        if (rehash_step <= 0) {
+            migrate(old_capacity);
+        }
+    }
 
-                // ���뵽��Ͱ
-                node->hash_next = new_buckets[new_index];
-                new_buckets[new_index] = node;
+    // 设置每次insert/remove搬迁的旧桶数，0为扩容时一次搬完
+    void set_rehash_step(int step) { rehash_step = step; }
 
-                node = next;
-            }
+    // 在空闲时调用：继续搬迁最多count个旧桶，搬完后准备下一次扩容的数组。
+    // 下一个数组有2×capacity个桶，要在再插入约0.375×capacity个节点之前写完，每次写4×count个桶。
+    // 返回是否还有没搬完的旧桶或没写完的下一个数组
+    bool rehash(int count) {
+        migrate(count);
+        if (old_buckets) {
+            return true;
         }
-
-        buckets = std::move(new_buckets);
+        if (!next_buckets && size > capacity * load_factor / 2) {
+            next_capacity = capacity * 2;
+            next_buckets = allocate(next_capacity);
+            prefault_index = 0;
+        }
+        if (next_buckets) {
+            prefault(4 * count);
+        }
+        return next_buckets && prefault_index < next_capacity;
     }
 
+    bool is_rehashing() const { return old_buckets != nullptr; }
+
     // ��գ���ɾ���ڵ㣩
     void clear() {
-        for (auto& bucket : buckets) {
-            bucket = nullptr;
-        }
+        std::fill(buckets.get(), buckets.get() + capacity, nullptr);
+        old_buckets.reset();
+        old_capacity = 0;
+        rehash_index = 0;
+        next_buckets.reset();
+        next_capacity = 0;
         size = 0;
     }
 
     int get_size() const { return size; }
     int get_capacity() const { return capacity; }
     double get_load_factor() const { return (double)size / capacity; }
-};
\ No newline at end of file
+};
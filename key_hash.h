@@ -0,0 +1,113 @@
+//key_hash.h
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string_view>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// key的哈希函数，按wyhash（final 4）的算法实现：每次读8字节、用64×64→128位乘法混合，
+// 短key只需要一两次乘法。种子在每个进程中随机生成，构造不出能让所有key落到同一个桶的请求。
+// 哈希表和分片都用它：值缓存在DataNode里，扩容时不再对key重新计算
+namespace key_hash_detail {
+
+    constexpr uint64_t SECRET[4] = {
+        0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+    };
+
+    inline void mum(uint64_t& a, uint64_t& b) {
+#if defined(_MSC_VER) && defined(_M_X64)
+        a = _umul128(a, b, &b);
+#else
+        __uint128_t r = static_cast<__uint128_t>(a) * b;
+        a = static_cast<uint64_t>(r);
+        b = static_cast<uint64_t>(r >> 64);
+#endif
+    }
+
+    inline uint64_t mix(uint64_t a, uint64_t b) {
+        mum(a, b);
+        return a ^ b;
+    }
+
+    // 按小端读取（x86/ARM均为小端）
+    inline uint64_t read8(const uint8_t* p) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+
+    inline uint64_t read4(const uint8_t* p) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+
+    inline uint64_t read3(const uint8_t* p, size_t k) {
+        return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+    }
+
+    inline uint64_t random_seed() {
+        std::random_device rd;
+        uint64_t seed = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+        return seed ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+}
+
+// 进程内所有key共用的种子，第一次使用时生成（全局对象的构造函数里也可以安全调用）
+inline uint64_t hash_seed() {
+    static const uint64_t seed = key_hash_detail::random_seed();
+    return seed;
+}
+
+inline uint64_t hash_key(std::string_view key, uint64_t seed = hash_seed()) {
+    using namespace key_hash_detail;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(key.data());
+    size_t len = key.size();
+    uint64_t a, b;
+
+    seed ^= mix(seed ^ SECRET[0], SECRET[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    a ^= SECRET[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+}
@@ -0,0 +1,431 @@
+//logger.h
+#pragma once
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 异步日志：每个线程一个无锁环形缓冲区（单生产者单消费者），日志在调用线程中直接格式化进槽位，
+// 后台线程定期取出写入文件（默认标准输出）。用法：
+//
+//     LOG_DEBUG("[GET] fd=" << client_fd << ", key=" << key);
+//
+// 级别低于当前级别时只有一次原子读取和一次比较，参数表达式不会被求值。
+// 缓冲区满时丢弃新的日志并计数，调用线程不会阻塞。
+
+enum class LogLevel : int {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    OFF
+};
+
+// 当前级别，默认INFO：逐条请求的DEBUG日志不输出
+inline std::atomic<int> g_log_level{static_cast<int>(LogLevel::INFO)};
+
+inline bool log_enabled(LogLevel level) {
+    return static_cast<int>(level) >= g_log_level.load(std::memory_order_relaxed);
+}
+
+// 单个线程的日志缓冲区：只有所属线程写入，只有后台线程读取
+class LogRing {
+public:
+    static const size_t SLOTS = 4096;       // 必须是2的幂
+    static const size_t TEXT_SIZE = 240;    // 单条日志的最大长度，超出部分截断
+
+    struct Slot {
+        int64_t time_us;
+        LogLevel level;
+        uint32_t length;
+        char text[TEXT_SIZE];
+    };
+
+private:
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> head_{0};   // 下一个写入位置
+    alignas(64) std::atomic<size_t> tail_{0};   // 下一个读取位置
+
+public:
+    std::atomic<bool> abandoned{false};         // 所属线程已退出，取空后由后台线程释放
+
+    LogRing() : slots_(new Slot[SLOTS]) {}
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // 生产者：返回下一个空槽位，缓冲区满时返回nullptr。写完后调用publish
+    Slot* acquire() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= SLOTS) {
+            return nullptr;
+        }
+        return &slots_[head & (SLOTS - 1)];
+    }
+
+    // 返回发布后缓冲区中的日志条数
+    size_t publish() {
+        size_t head = head_.load(std::memory_order_relaxed) + 1;
+        head_.store(head, std::memory_order_release);
+        return head - tail_.load(std::memory_order_relaxed);
+    }
+
+    // 消费者：依次处理已发布的日志，返回处理的条数
+    template<typename Fn>
+    size_t consume(Fn&& fn) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        for (size_t i = tail; i != head; i++) {
+            fn(slots_[i & (SLOTS - 1)]);
+        }
+        tail_.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+};
+
+class Logger {
+    friend class LogLine;
+
+private:
+    // 线程退出时标记缓冲区，剩余的日志仍会被写出
+    struct ThreadRing {
+        std::shared_ptr<LogRing> ring;
+
+        ~ThreadRing() {
+            if (ring) {
+                ring->abandoned.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+    std::atomic<uint64_t> dropped_{0};
+
+    std::mutex mutex_;              // 保护以下成员
+    std::condition_variable cv_;
+    std::thread thread_;
+    bool running_ = false;
+    FILE* file_ = nullptr;
+    bool owns_file_ = false;
+
+    // 以下只在后台线程中访问
+    uint64_t reported_dropped_ = 0;
+    // 时间前缀按秒缓存，同一秒内的日志不重复调用localtime_r
+    time_t cached_second_ = -1;
+    char cached_prefix_[32] = {};
+
+    Logger() = default;
+
+    LogRing* thread_ring() {
+        thread_local ThreadRing local;
+        if (!local.ring) {
+            local.ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.push_back(local.ring);
+        }
+        return local.ring.get();
+    }
+
+    static const char* level_name(LogLevel level) {
+        switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO ";
+        case LogLevel::WARN: return "WARN ";
+        case LogLevel::ERROR: return "ERROR";
+        default: return "";
+        }
+    }
+
+    // 格式化为"2026-01-01 12:00:00.123 INFO  内容\n"
+    void format_record(const LogRing::Slot& slot, std::string& out) {
+        time_t second = static_cast<time_t>(slot.time_us / 1000000);
+        if (second != cached_second_) {
+            tm local_time;
+            localtime_r(&second, &local_time);
+            strftime(cached_prefix_, sizeof(cached_prefix_), "%Y-%m-%d %H:%M:%S", &local_time);
+            cached_second_ = second;
+        }
+        int ms = static_cast<int>(slot.time_us / 1000 % 1000);
+        char millis[5] = { '.', static_cast<char>('0' + ms / 100),
+                           static_cast<char>('0' + ms / 10 % 10), static_cast<char>('0' + ms % 10), ' ' };
+
+        out += cached_prefix_;
+        out.append(millis, sizeof(millis));
+        out += level_name(slot.level);
+        out += ' ';
+        out.append(slot.text, slot.length);
+        out += '\n';
+    }
+
+    // 取出所有线程的日志写入文件（由stdio缓冲，空闲时才fflush），返回写出的条数
+    size_t drain(std::vector<std::shared_ptr<LogRing>>& rings, std::string& out) {
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings = rings_;
+        }
+
+        size_t count = 0;
+        for (const auto& ring : rings) {
+            count += ring->consume([&](const LogRing::Slot& slot) { format_record(slot, out); });
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped_) {
+            out += "[日志] 缓冲区已满，丢弃了";
+            out += std::to_string(dropped - reported_dropped_);
+            out += "条日志\n";
+            reported_dropped_ = dropped;
+        }
+
+        if (!out.empty()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (file_) {
+                fwrite(out.data(), 1, out.size(), file_);
+            }
+        }
+        out.clear();
+
+        // 释放已退出线程的缓冲区
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        for (size_t i = 0; i < rings_.size();) {
+            if (rings_[i]->abandoned.load(std::memory_order_acquire) && rings_[i]->empty()) {
+                rings_[i] = std::move(rings_.back());
+                rings_.pop_back();
+            } else {
+                i++;
+            }
+        }
+        return count;
+    }
+
+    // 有日志时连续写出，空闲时每10ms检查一次；缓冲区过半时生产者会提前唤醒
+    void run() {
+        std::vector<std::shared_ptr<LogRing>> rings;
+        std::string out;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            bool stopping = !running_;
+            lock.unlock();
+            size_t count = drain(rings, out);
+            lock.lock();
+            if (stopping) {
+                break;
+            }
+            if (count == 0) {
+                if (file_) {
+                    fflush(file_);
+                }
+                cv_.wait_for(lock, std::chrono::milliseconds(10), [this]() { return !running_; });
+            }
+        }
+    }
+
+    void wake() {
+        cv_.notify_one();
+    }
+
+    void close_file() {
+        if (owns_file_ && file_) {
+            fclose(file_);
+        }
+        file_ = nullptr;
+        owns_file_ = false;
+    }
+
+public:
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger() {
+        stop();
+    }
+
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    static void set_level(LogLevel level) {
+        g_log_level.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    static LogLevel level() {
+        return static_cast<LogLevel>(g_log_level.load(std::memory_order_relaxed));
+    }
+
+    // 解析debug/info/warn/error/off
+    static bool parse_level(std::string_view name, LogLevel& level) {
+        static const std::pair<std::string_view, LogLevel> names[] = {
+            { "debug", LogLevel::DEBUG },
+            { "info", LogLevel::INFO },
+            { "warn", LogLevel::WARN },
+            { "error", LogLevel::ERROR },
+            { "off", LogLevel::OFF },
+        };
+        for (const auto& entry : names) {
+            if (entry.first == name) {
+                level = entry.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 启动后台线程，path为空时写到标准输出；已启动时只切换输出文件
+    bool start(const std::string& path = std::string()) {
+        FILE* file = stdout;
+        if (!path.empty()) {
+            file = fopen(path.c_str(), "a");
+            if (!file) {
+                return false;
+            }
+            setvbuf(file, nullptr, _IOFBF, 256 * 1024);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        close_file();
+        file_ = file;
+        owns_file_ = !path.empty();
+        if (!running_) {
+            running_ = true;
+            thread_ = std::thread([this]() { run(); });
+        }
+        return true;
+    }
+
+    // 写出已有的日志后停止后台线程
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) {
+                return;
+            }
+            running_ = false;
+        }
+        cv_.notify_one();
+        thread_.join();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_) {
+            fflush(file_);
+        }
+        close_file();
+    }
+
+    uint64_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+};
+
+// 一条日志：构造时在当前线程的缓冲区中取一个槽位，operator<<直接写入槽位，析构时发布
+class LogLine {
+private:
+    LogRing* ring_;
+    LogRing::Slot* slot_;
+    LogRing::Slot overflow_;    // 缓冲区满时写到这里然后丢弃
+    char* pos_;
+    char* end_;
+
+public:
+    explicit LogLine(LogLevel level) {
+        Logger& logger = Logger::instance();
+        ring_ = logger.thread_ring();
+        slot_ = ring_->acquire();
+        if (!slot_) {
+            logger.dropped_.fetch_add(1, std::memory_order_relaxed);
+            ring_ = nullptr;
+            slot_ = &overflow_;
+        }
+        slot_->time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        slot_->level = level;
+        pos_ = slot_->text;
+        end_ = slot_->text + LogRing::TEXT_SIZE;
+    }
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    ~LogLine() {
+        slot_->length = static_cast<uint32_t>(pos_ - slot_->text);
+        if (ring_ && ring_->publish() == LogRing::SLOTS / 2) {
+            Logger::instance().wake();
+        }
+    }
+
+    LogLine& operator<<(std::string_view s) {
+        size_t n = s.size();
+        if (n > static_cast<size_t>(end_ - pos_)) {
+            n = end_ - pos_;
+        }
+        memcpy(pos_, s.data(), n);
+        pos_ += n;
+        return *this;
+    }
+
+    LogLine& operator<<(const char* s) {
+        return *this << std::string_view(s);
+    }
+
+    LogLine& operator<<(const std::string& s) {
+        return *this << std::string_view(s);
+    }
+
+    LogLine& operator<<(char c) {
+        if (pos_ < end_) {
+            *pos_++ = c;
+        }
+        return *this;
+    }
+
+    LogLine& operator<<(bool value) {
+        return *this << (value ? "true" : "false");
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    LogLine& operator<<(T value) {
+        pos_ = std::to_chars(pos_, end_, value).ptr;
+        return *this;
+    }
+
+    LogLine& operator<<(double value) {
+        // 缓冲区已满时snprintf不写入但仍返回需要的长度，下面的end_ - pos_ - 1会让pos_后退
+        if (pos_ == end_) {
+            return *this;
+        }
+        int n = snprintf(pos_, end_ - pos_, "%g", value);
+        if (n > 0) {
+            pos_ += n < end_ - pos_ ? n : end_ - pos_ - 1;
+        }
+        return *this;
+    }
+};
+
+#define LOG_AT(level, expr) \
+    do { \
+        if (log_enabled(level)) { \
+            LogLine log_line_(level); \
+            log_line_ << expr; \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(expr) LOG_AT(LogLevel::DEBUG, expr)
+#define LOG_INFO(expr) LOG_AT(LogLevel::INFO, expr)
+#define LOG_WARN(expr) LOG_AT(LogLevel::WARN, expr)
+#define LOG_ERROR(expr) LOG_AT(LogLevel::ERROR, expr)
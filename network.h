@@ -9,8 +9,21 @@
 #include <cerrno>
 #include <unordered_map>
 #include <sys/epoll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
 #include <unistd.h>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <sys/eventfd.h>
+#include "timer.h"
+
+// 编译器支持C++20协程时提供EventLoop::sleep和coro.h中的协程接口
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define HAVE_COROUTINES 1
+#endif
 
 
 // 事件类型
@@ -30,6 +43,18 @@ public:
     
     // 获取文件描述符
     virtual int get_fd() const = 0;
+    
+    // 以下为完成式事件循环（UringLoop）的回调，由事件循环完成I/O后调用
+    
+    // 接受到新连接
+    virtual void handle_accept(int /*client_fd*/, const sockaddr_in& /*addr*/) {}
+    
+    // 收到数据，len<=0表示对端关闭(0)或出错(-errno)
+    virtual void handle_recv(int /*fd*/, const char* /*data*/, ssize_t /*len*/) {}
+    
+    // 发送完成，len为实际发送的字节数或-errno；fd已删除时也会回调（fd为-1），
+    // 处理器在此之前不能释放发送中的数据
+    virtual void handle_send(int /*fd*/, ssize_t /*len*/) {}
 };
 
 // 连接处理器（不再继承EventHandler）
@@ -40,8 +65,9 @@ public:
     // 当新连接建立时调用
     virtual void on_connected(int client_fd, const sockaddr_in& addr) = 0;
     
-    // 当收到数据时调用
-    virtual void on_data(int client_fd, const char* data, size_t len) = 0;
+    // 当收到数据时调用，data为连接中所有未处理的数据；
+    // 返回已处理的字节数，剩余部分（不完整的请求）保留到下次收到数据时一起传入
+    virtual size_t on_data(int client_fd, const char* data, size_t len) = 0;
     
     // 当连接关闭时调用
     virtual void on_closed(int client_fd) = 0;
@@ -50,10 +76,25 @@ public:
     virtual bool send_data(int client_fd, const char* data, size_t len) = 0;
 };
 
+// 忙轮询统计，只在事件循环线程中修改
+struct BusyPollStats {
+    uint64_t spin_hits = 0;       // 自旋期间等到事件的次数
+    uint64_t spin_timeouts = 0;   // 自旋窗口内没有事件、转为阻塞等待的次数
+    uint64_t blocking_waits = 0;  // 阻塞等待的次数（不含0超时的轮询）
+};
+
 // 事件循环接口
 class EventLoop {
 public:
-    virtual ~EventLoop() = default;
+    EventLoop() {
+        wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    
+    virtual ~EventLoop() {
+        if (wakeup_fd_ >= 0) {
+            close(wakeup_fd_);
+        }
+    }
     
     // 添加事件监听
     virtual bool add_event(int fd, EventType events, EventHandler* handler) = 0;
@@ -64,30 +105,208 @@ public:
     // 删除事件
     virtual bool del_event(int fd) = 0;
     
-    // 运行事件循环
+    // 运行事件循环，直到stop()被调用
     virtual void run() = 0;
     
-    // 停止事件循环
-    virtual void stop() = 0;
+    // 停止事件循环：可以在任意线程（包括信号处理函数）中调用，
+    // 只写原子变量和eventfd，事件循环被立即唤醒并退出；在run()之前调用时下一次run()立即返回
+    virtual void stop() {
+        quit_ = true;
+        wakeup();
+    }
+    
+    // 把任务交给事件循环线程执行，可以在任意线程调用
+    void queue_in_loop(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending_tasks_.push_back(std::move(task));
+        }
+        wakeup();
+    }
+    
+    // 在事件循环线程中调用时直接执行，否则交给事件循环线程
+    void run_in_loop(std::function<void()> task) {
+        if (in_loop_thread()) {
+            task();
+        } else {
+            queue_in_loop(std::move(task));
+        }
+    }
+    
+    bool in_loop_thread() const {
+        return loop_thread_.load() == std::this_thread::get_id();
+    }
+    
+    // 事件模型名称
+    virtual const char* name() const = 0;
+    
+    // 是否为边缘触发（就绪的fd需要读/accept到EAGAIN）
+    virtual bool edge_triggered() const { return false; }
+    
+    // 是否为完成式I/O：accept/recv/send由事件循环执行，结果通过
+    // EventHandler::handle_accept/handle_recv/handle_send回调
+    virtual bool completion_based() const { return false; }
+    
+    // 忙轮询：处理完事件后的spin_us微秒内以0超时轮询而不睡眠，用一个核换取更低的唤醒延迟；
+    // 0为关闭。不支持的事件循环返回false
+    virtual bool set_busy_poll(int /*spin_us*/) { return false; }
+    
+    virtual BusyPollStats busy_poll_stats() const { return BusyPollStats(); }
+    
+    // 在监听socket上持续接受连接
+    virtual bool async_accept(int /*listen_fd*/, EventHandler* /*handler*/) { return false; }
+    
+    // 在fd上持续接收数据
+    virtual bool async_recv(int /*fd*/, EventHandler* /*handler*/) { return false; }
+    
+    // 发送iov中的数据，每个fd同时只能有一个发送请求；iov指向的数据在handle_send回调前必须有效
+    virtual bool async_send(int /*fd*/, const iovec* /*iov*/, int /*iovcnt*/, EventHandler* /*handler*/) { return false; }
+    
+    // 延迟delay_ms后执行一次回调；定时器接口只能在事件循环线程中调用，其他线程可通过queue_in_loop
+    TimerId run_after(int delay_ms, std::function<void()> callback) {
+        uint64_t delay = delay_ms > 0 ? static_cast<uint64_t>(delay_ms) : 0;
+        return timers_.add(now_ms_ + delay, 0, std::move(callback));
+    }
+    
+    // 每隔interval_ms执行一次回调，直到被取消
+    TimerId run_every(int interval_ms, std::function<void()> callback) {
+        uint64_t interval = interval_ms > 0 ? static_cast<uint64_t>(interval_ms) : 1;
+        return timers_.add(now_ms_ + interval, interval, std::move(callback));
+    }
+    
+    // 取消定时器，已执行过的一次性定时器返回false
+    bool cancel_timer(TimerId id) {
+        return timers_.cancel(id);
+    }
+    
+    // 事件循环的当前时间（ms，从创建事件循环开始计），每次等待返回后更新
+    uint64_t now_ms() const { return now_ms_; }
+    
+#ifdef HAVE_COROUTINES
+    // co_await loop.sleep(ms)：挂起当前协程，ms毫秒后由事件循环线程恢复
+    struct SleepAwaiter {
+        EventLoop* loop;
+        int ms;
+        
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            loop->run_after(ms, [handle]() { handle.resume(); });
+        }
+        void await_resume() const noexcept {}
+    };
+    
+    SleepAwaiter sleep(int ms) { return SleepAwaiter{this, ms}; }
+#endif
     
     // 创建事件循环实例
     static std::unique_ptr<EventLoop> create(const std::string& type);
+    
+protected:
+    std::atomic<bool> quit_{false};
+    TimerWheel timers_;
+    std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+    uint64_t now_ms_ = 0;
+    
+    void update_time() {
+        now_ms_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time_).count());
+    }
+    
+    // 本轮等待的超时时间：最近的定时器到期时间，没有定时器时一直等待（-1）。
+    // eventfd创建或注册失败时最多等待1秒，以便检查退出标志
+    int wait_timeout() {
+        update_time();
+        int timeout = timers_.next_timeout(now_ms_);
+        if (!wakeup_registered_ && (timeout < 0 || timeout > 1000)) {
+            return 1000;
+        }
+        return timeout;
+    }
+    
+    // 等待返回后执行所有到期的定时器
+    void process_timers() {
+        update_time();
+        timers_.advance(now_ms_);
+    }
+    
+    // run()开始时调用：记录事件循环线程，第一次运行时注册唤醒fd
+    void begin_run() {
+        loop_thread_ = std::this_thread::get_id();
+        if (!wakeup_registered_ && wakeup_fd_ >= 0) {
+            wakeup_registered_ = add_event(wakeup_fd_, EventType::READ, &wakeup_handler_);
+        }
+    }
+    
+    // run()返回前调用，消耗掉本次的停止请求，之后可以再次run()
+    void end_run() {
+        quit_ = false;
+        loop_thread_ = std::thread::id();
+    }
+    
+private:
+    class WakeupHandler : public EventHandler {
+    private:
+        EventLoop* loop_;
+        
+    public:
+        explicit WakeupHandler(EventLoop* loop) : loop_(loop) {}
+        
+        int get_fd() const override { return loop_->wakeup_fd_; }
+        
+        void handle_event(int /*fd*/, EventType /*events*/) override {
+            loop_->handle_wakeup();
+        }
+    };
+    
+    int wakeup_fd_{-1};
+    bool wakeup_registered_ = false;
+    std::atomic<bool> wakeup_pending_{false};  // 已写eventfd但事件循环尚未处理
+    WakeupHandler wakeup_handler_{this};
+    std::atomic<std::thread::id> loop_thread_{};
+    
+    std::mutex pending_mutex_;
+    std::vector<std::function<void()>> pending_tasks_;
+    
+    // 异步信号安全：只有原子操作和write
+    void wakeup() {
+        if (wakeup_fd_ >= 0 && !wakeup_pending_.exchange(true)) {
+            uint64_t one = 1;
+            ssize_t ret = write(wakeup_fd_, &one, sizeof(one));
+            (void)ret;
+        }
+    }
+    
+    void handle_wakeup() {
+        uint64_t value;
+        ssize_t ret = read(wakeup_fd_, &value, sizeof(value));
+        (void)ret;
+        
+        // 先清除标志再取任务，之后提交的任务会重新唤醒
+        wakeup_pending_ = false;
+        
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            tasks.swap(pending_tasks_);
+        }
+        for (auto& task : tasks) {
+            task();
+        }
+    }
 };
 
 class PollLoop : public EventLoop {
 private:
     std::vector<pollfd> poll_fds_;
-    std::unordered_map<int, EventHandler*> handlers_;
-    std::atomic<bool> running_{false};
+    std::vector<EventHandler*> slot_handlers_;  // 与poll_fds_一一对应
+    std::vector<int> fd_index_;                 // fd -> 在poll_fds_中的位置，-1表示未注册
     
     // 查找fd在poll_fds_中的索引
-    int find_fd_index(int fd) {
-        for (size_t i = 0; i < poll_fds_.size(); i++) {
-            if (poll_fds_[i].fd == fd) {
-                return static_cast<int>(i);
-            }
+    int find_fd_index(int fd) const {
+        if (fd < 0 || static_cast<size_t>(fd) >= fd_index_.size()) {
+            return -1;
         }
-        return -1;
+        return fd_index_[fd];
     }
     
     // 转换为poll事件
@@ -121,7 +340,10 @@ public:
     ~PollLoop() override = default;
     
     bool add_event(int fd, EventType events, EventHandler* handler) override {
-        if (handlers_.find(fd) != handlers_.end()) {
+        if (fd < 0) {
+            return false;
+        }
+        if (find_fd_index(fd) != -1) {
             return false;  // 已存在
         }
         
@@ -130,80 +352,89 @@ public:
         pfd.events = events_to_poll(events);
         pfd.revents = 0;
         
+        if (static_cast<size_t>(fd) >= fd_index_.size()) {
+            fd_index_.resize(fd + 1, -1);
+        }
+        fd_index_[fd] = static_cast<int>(poll_fds_.size());
         poll_fds_.push_back(pfd);
-        handlers_[fd] = handler;
+        slot_handlers_.push_back(handler);
         return true;
     }
     
     bool mod_event(int fd, EventType events, EventHandler* handler) override {
-        auto it = handlers_.find(fd);
-        if (it == handlers_.end()) {
-            return false;
-        }
-        
         int index = find_fd_index(fd);
         if (index == -1) {
             return false;
         }
         
         poll_fds_[index].events = events_to_poll(events);
-        handlers_[fd] = handler;
+        slot_handlers_[index] = handler;
         return true;
     }
     
+    // 用最后一个元素填补被删除的位置，O(1)
     bool del_event(int fd) override {
-        auto it = handlers_.find(fd);
-        if (it == handlers_.end()) {
+        int index = find_fd_index(fd);
+        if (index == -1) {
             return false;
         }
         
-        int index = find_fd_index(fd);
-        if (index != -1) {
-            poll_fds_.erase(poll_fds_.begin() + index);
+        size_t last = poll_fds_.size() - 1;
+        if (static_cast<size_t>(index) != last) {
+            poll_fds_[index] = poll_fds_[last];
+            slot_handlers_[index] = slot_handlers_[last];
+            fd_index_[poll_fds_[index].fd] = index;
         }
-        
-        handlers_.erase(fd);
+        poll_fds_.pop_back();
+        slot_handlers_.pop_back();
+        fd_index_[fd] = -1;
         return true;
     }
     
     void run() override {
-        running_ = true;
+        begin_run();
         
-        while (running_) {
-            // 调用poll，超时时间1000ms
-            int ready = poll(poll_fds_.data(), poll_fds_.size(), 1000);
+        while (!quit_) {
+            // 调用poll，超时时间由最近的定时器决定
+            int ready = poll(poll_fds_.data(), poll_fds_.size(), wait_timeout());
             
             if (ready < 0) {
                 if (errno == EINTR) continue;
                 break;  // 发生错误
             }
             
+            process_timers();
+            
             if (ready == 0) {
                 continue;  // 超时
             }
             
             // 处理就绪的事件
-            for (size_t i = 0; i < poll_fds_.size(); i++) {
-                if (poll_fds_[i].revents != 0) {
-                    int fd = poll_fds_[i].fd;
-                    EventType events = poll_to_events(poll_fds_[i].revents);
-                    
-                    auto it = handlers_.find(fd);
-                    if (it != handlers_.end()) {
-                        it->second->handle_event(fd, events);
-                    }
-                    
-                    if (--ready <= 0) {
-                        break;  // 所有就绪事件已处理
-                    }
+            size_t i = 0;
+            while (i < poll_fds_.size() && ready > 0) {
+                short revents = poll_fds_[i].revents;
+                if (revents == 0) {
+                    i++;
+                    continue;
                 }
+                
+                int fd = poll_fds_[i].fd;
+                poll_fds_[i].revents = 0;
+                ready--;
+                slot_handlers_[i]->handle_event(fd, poll_to_events(revents));
+                
+                // 处理器删除了自己的fd时，最后一个元素被换到了位置i，它还没有处理过
+                if (i < poll_fds_.size() && poll_fds_[i].fd != fd) {
+                    continue;
+                }
+                i++;
             }
         }
+        
+        end_run();
     }
     
-    void stop() override {
-        running_ = false;
-    }
+    const char* name() const override { return "poll"; }
 };
 
 
@@ -211,13 +442,65 @@ public:
 class EpollLoop : public EventLoop {
 private:
     int epoll_fd_{-1};
-    std::unordered_map<int, EventHandler*> handlers_;
-    std::atomic<bool> running_{false};
+    bool edge_triggered_{false};
+    std::vector<EventHandler*> handlers_;  // fd -> 处理器，nullptr表示未注册
     static const int MAX_EVENTS = 64;
     
+    // 本轮epoll_wait返回、尚未分发的事件，del_event时从中清除该处理器
+    epoll_event* ready_events_ = nullptr;
+    int ready_next_ = 0;
+    int ready_count_ = 0;
+    
+    // 忙轮询
+    int64_t spin_ns_ = 0;                 // 自旋窗口，0为关闭
+    std::chrono::steady_clock::time_point last_active_;
+    bool spinning_ = false;               // 上一轮有事件，处于自旋窗口内
+    BusyPollStats busy_stats_;
+    
+    EventHandler* find_handler(int fd) const {
+        if (fd < 0 || static_cast<size_t>(fd) >= handlers_.size()) {
+            return nullptr;
+        }
+        return handlers_[fd];
+    }
+    
+    // 等待事件。开启忙轮询时，有事件后的一个窗口内只做0超时的epoll_wait，
+    // 窗口内一直没有事件才按timeout阻塞；有到期的定时器时(timeout为0)不自旋
+    int wait_events(epoll_event* events, int timeout) {
+        int ready;
+        if (spinning_ && timeout != 0) {
+            ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, 0);
+            if (ready > 0) {
+                busy_stats_.spin_hits++;
+            } else if (ready == 0) {
+                if (std::chrono::steady_clock::now() - last_active_ < std::chrono::nanoseconds(spin_ns_)) {
+                    return 0;
+                }
+                spinning_ = false;
+                busy_stats_.spin_timeouts++;
+                busy_stats_.blocking_waits++;
+                ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout);
+            }
+        } else {
+            if (timeout != 0) {
+                busy_stats_.blocking_waits++;
+            }
+            ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout);
+        }
+        
+        if (ready > 0 && spin_ns_ > 0) {
+            spinning_ = true;
+            last_active_ = std::chrono::steady_clock::now();
+        }
+        return ready;
+    }
+    
     // 转换为epoll事件
     uint32_t events_to_epoll(EventType events) {
         uint32_t result = 0;
+        if (edge_triggered_) {
+            result |= EPOLLET;
+        }
         if (static_cast<int>(events) & static_cast<int>(EventType::READ)) {
             result |= EPOLLIN;
         }
@@ -242,7 +525,8 @@ private:
     }
     
 public:
-    EpollLoop() {
+    explicit EpollLoop(bool edge_triggered = false)
+        : edge_triggered_(edge_triggered) {
         epoll_fd_ = epoll_create1(0);
     }
     
@@ -252,32 +536,35 @@ public:
         }
     }
     
+    // data.ptr直接指向处理器，分发事件时不需要查表
     bool add_event(int fd, EventType events, EventHandler* handler) override {
-        if (handlers_.find(fd) != handlers_.end()) {
+        if (fd < 0 || find_handler(fd) != nullptr) {
             return false;
         }
         
         epoll_event ev;
         ev.events = events_to_epoll(events);
-        ev.data.fd = fd;
+        ev.data.ptr = handler;
         
         if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
             return false;
         }
         
+        if (static_cast<size_t>(fd) >= handlers_.size()) {
+            handlers_.resize(fd + 1, nullptr);
+        }
         handlers_[fd] = handler;
         return true;
     }
     
     bool mod_event(int fd, EventType events, EventHandler* handler) override {
-        auto it = handlers_.find(fd);
-        if (it == handlers_.end()) {
+        if (find_handler(fd) == nullptr) {
             return false;
         }
         
         epoll_event ev;
         ev.events = events_to_epoll(events);
-        ev.data.fd = fd;
+        ev.data.ptr = handler;
         
         if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) < 0) {
             return false;
@@ -288,8 +575,8 @@ public:
     }
     
     bool del_event(int fd) override {
-        auto it = handlers_.find(fd);
-        if (it == handlers_.end()) {
+        EventHandler* handler = find_handler(fd);
+        if (handler == nullptr) {
             return false;
         }
         
@@ -297,7 +584,14 @@ public:
             return false;
         }
         
-        handlers_.erase(fd);
+        handlers_[fd] = nullptr;
+        
+        // 本轮中该fd尚未分发的事件作废，处理器此后可能被释放或复用
+        for (int i = ready_next_; i < ready_count_; i++) {
+            if (ready_events_[i].data.ptr == handler) {
+                ready_events_[i].data.ptr = nullptr;
+            }
+        }
         return true;
     }
     
@@ -306,30 +600,49 @@ public:
             return;
         }
         
-        running_ = true;
+        begin_run();
         epoll_event events[MAX_EVENTS];
         
-        while (running_) {
-            int ready = epoll_wait(epoll_fd_, events, MAX_EVENTS, 1000);
+        while (!quit_) {
+            int ready = wait_events(events, wait_timeout());
             
             if (ready < 0) {
                 if (errno == EINTR) continue;
                 break;
             }
             
+            ready_events_ = events;
+            ready_next_ = 0;
+            ready_count_ = ready;
+            
+            process_timers();
+            
             for (int i = 0; i < ready; i++) {
-                int fd = events[i].data.fd;
-                EventType evt = epoll_to_events(events[i].events);
-                
-                auto it = handlers_.find(fd);
-                if (it != handlers_.end()) {
-                    it->second->handle_event(fd, evt);
+                ready_next_ = i + 1;
+                EventHandler* handler = static_cast<EventHandler*>(events[i].data.ptr);
+                if (handler != nullptr) {
+                    handler->handle_event(handler->get_fd(), epoll_to_events(events[i].events));
                 }
             }
+            ready_count_ = 0;
         }
+        
+        end_run();
     }
     
-    void stop() override {
-        running_ = false;
+    const char* name() const override {
+        return edge_triggered_ ? "epoll-et" : "epoll";
     }
+    
+    bool set_busy_poll(int spin_us) override {
+        spin_ns_ = spin_us > 0 ? static_cast<int64_t>(spin_us) * 1000 : 0;
+        if (spin_ns_ == 0) {
+            spinning_ = false;
+        }
+        return true;
+    }
+    
+    BusyPollStats busy_poll_stats() const override { return busy_stats_; }
+    
+    bool edge_triggered() const override { return edge_triggered_; }
 };
\ No newline at end of file
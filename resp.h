@@ -0,0 +1,557 @@
+//resp.h
+#pragma once
+#include "command.h"
+#include <charconv>
+#include <string_view>
+#include <vector>
+
+// RESP2（Redis协议）前端：可以直接用redis-cli、redis-benchmark、memtier等工具访问。
+// 每个key对应一个User：
+//   GET key / SET key value      读写用户的name
+//   MGET key [key ...]           批量读取name
+//   MSET key value [key value ...] 批量写name
+//   DEL key [key ...]            删除用户
+//   HSET key field value [...]   修改name/email/phone/cash字段，返回修改的字段数
+//   HGETALL key                  返回id、name、email、phone、cash
+//   INCRBY key delta             cash加delta，返回新值
+//   PING [message]
+// 不存在的用户被创建时与文本协议相同：数字key作为id，否则作为name。
+
+// 一次请求最多的参数个数和单个参数的最大长度，超过视为协议错误
+const size_t RESP_MAX_ARGS = 1024 * 1024;
+const long long RESP_MAX_BULK = 512 * 1024 * 1024;
+
+enum class RespStatus {
+    COMPLETE,
+    INCOMPLETE,
+    PROTOCOL_ERROR
+};
+
+// 找到从p开始的一行，返回'\r\n'中'\r'的位置；数据不足时返回nullptr
+inline const char* resp_find_line(const char* p, const char* end) {
+    const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (!newline) {
+        return nullptr;
+    }
+    return (newline > p && newline[-1] == '\r') ? newline - 1 : newline;
+}
+
+// 解析一个请求，args指向data内部。支持多条批量字符串组成的数组（*N\r\n$len\r\n...\r\n）
+// 和按空格分隔的内联命令；空请求返回COMPLETE且args为空
+inline RespStatus parse_resp_request(const char* data, size_t len,
+                                     std::vector<std::string_view>& args, size_t& consumed) {
+    args.clear();
+    const char* p = data;
+    const char* end = data + len;
+    if (p == end) {
+        return RespStatus::INCOMPLETE;
+    }
+
+    if (*p != '*') {
+        // 内联命令
+        const char* line_end = resp_find_line(p, end);
+        if (!line_end) {
+            return RespStatus::INCOMPLETE;
+        }
+        const char* q = p;
+        while (q < line_end) {
+            while (q < line_end && *q == ' ') q++;
+            const char* token = q;
+            while (q < line_end && *q != ' ') q++;
+            if (q > token) {
+                args.emplace_back(token, q - token);
+            }
+        }
+        consumed = (line_end - data) + (*line_end == '\r' ? 2 : 1);
+        return RespStatus::COMPLETE;
+    }
+
+    const char* line_end = resp_find_line(p, end);
+    if (!line_end) {
+        return RespStatus::INCOMPLETE;
+    }
+    long long count = 0;
+    auto result = std::from_chars(p + 1, line_end, count);
+    if (result.ec != std::errc() || result.ptr != line_end || count > static_cast<long long>(RESP_MAX_ARGS)) {
+        return RespStatus::PROTOCOL_ERROR;
+    }
+    p = line_end + (*line_end == '\r' ? 2 : 1);
+
+    for (long long i = 0; i < count; i++) {
+        if (p == end) {
+            return RespStatus::INCOMPLETE;
+        }
+        if (*p != '$') {
+            return RespStatus::PROTOCOL_ERROR;
+        }
+        line_end = resp_find_line(p, end);
+        if (!line_end) {
+            return RespStatus::INCOMPLETE;
+        }
+        long long size = 0;
+        result = std::from_chars(p + 1, line_end, size);
+        if (result.ec != std::errc() || result.ptr != line_end || size < 0 || size > RESP_MAX_BULK) {
+            return RespStatus::PROTOCOL_ERROR;
+        }
+        p = line_end + (*line_end == '\r' ? 2 : 1);
+        if (end - p < size + 2) {
+            return RespStatus::INCOMPLETE;
+        }
+        if (p[size] != '\r' || p[size + 1] != '\n') {
+            return RespStatus::PROTOCOL_ERROR;
+        }
+        args.emplace_back(p, static_cast<size_t>(size));
+        p += size + 2;
+    }
+
+    consumed = p - data;
+    return RespStatus::COMPLETE;
+}
+
+inline void resp_append_simple(std::string& out, std::string_view s) {
+    out += '+';
+    out.append(s.data(), s.size());
+    out += "\r\n";
+}
+
+inline void resp_append_error(std::string& out, std::string_view s) {
+    out += '-';
+    out.append(s.data(), s.size());
+    out += "\r\n";
+}
+
+inline void resp_append_integer(std::string& out, long long value, char prefix = ':') {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out += prefix;
+    out.append(buf, result.ptr - buf);
+    out += "\r\n";
+}
+
+inline void resp_append_bulk(std::string& out, std::string_view s) {
+    resp_append_integer(out, static_cast<long long>(s.size()), '$');
+    out.append(s.data(), s.size());
+    out += "\r\n";
+}
+
+inline void resp_append_null(std::string& out) {
+    out += "$-1\r\n";
+}
+
+inline void resp_append_array(std::string& out, size_t count) {
+    resp_append_integer(out, static_cast<long long>(count), '*');
+}
+
+// 大小写无关的比较，name为大写
+inline bool resp_command_is(std::string_view arg, std::string_view name) {
+    if (arg.size() != name.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < arg.size(); i++) {
+        char c = arg[i];
+        if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+        if (c != name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// RESP2连接处理器，与CommandHandler使用同一个存储引擎
+class RespHandler : public ConnectionHandler {
+private:
+    NetworkServer* server_;
+    StorageEngine& storage_engine_;
+    std::vector<std::string_view> args_;   // 事件循环线程中复用
+
+    enum class Command {
+        GET,
+        SET,
+        DEL,
+        MGET,
+        MSET,
+        HSET,
+        HGETALL,
+        INCRBY,
+        PING
+    };
+
+    struct CommandEntry {
+        std::string_view name;
+        Command command;
+        int arity;              // 包括命令名的参数个数，负数表示至少-arity个
+    };
+
+    static constexpr CommandEntry COMMANDS[] = {
+        { "GET",     Command::GET,     2 },
+        { "SET",     Command::SET,     3 },
+        { "DEL",     Command::DEL,     -2 },
+        { "MGET",    Command::MGET,    -2 },
+        { "MSET",    Command::MSET,    -3 },
+        { "HSET",    Command::HSET,    -4 },
+        { "HGETALL", Command::HGETALL, 2 },
+        { "INCRBY",  Command::INCRBY,  3 },
+        { "PING",    Command::PING,    -1 },
+    };
+
+    // 一次加锁内原地修改用户，不存在时按key创建；失败时写入错误回复并返回false
+    template<typename Fn>
+    bool update_or_create(const std::string& key, Fn&& fn, std::string& reply) {
+        auto status = storage_engine_.update(key, std::forward<Fn>(fn),
+            [&key](User& user) { return CommandHandler::new_user(key, user); });
+
+        switch (status) {
+        case StorageEngine::UpdateStatus::UPDATED:
+            return true;
+        case StorageEngine::UpdateStatus::NOT_FOUND:
+            resp_append_error(reply, "ERR invalid id");
+            return false;
+        default:
+            resp_append_error(reply, "ERR store failed");
+            return false;
+        }
+    }
+
+    void handle_get(const std::vector<std::string_view>& args, std::string& reply) {
+        auto result = storage_engine_.get(std::string(args[1]));
+        if (result.first) {
+            resp_append_bulk(reply, result.second.name);
+        }
+        else {
+            resp_append_null(reply);
+        }
+    }
+
+    void handle_set(const std::vector<std::string_view>& args, std::string& reply) {
+        auto apply = [&](User& user) {
+            user.name = args[2];
+            return true;
+        };
+        if (update_or_create(std::string(args[1]), apply, reply)) {
+            resp_append_simple(reply, "OK");
+        }
+    }
+
+    void handle_del(const std::vector<std::string_view>& args, std::string& reply) {
+        long long deleted = 0;
+        for (size_t i = 1; i < args.size(); i++) {
+            if (storage_engine_.del(std::string(args[i]))) {
+                deleted++;
+            }
+        }
+        resp_append_integer(reply, deleted);
+    }
+
+    void handle_mget(const std::vector<std::string_view>& args, std::string& reply) {
+        std::vector<std::string> keys(args.begin() + 1, args.end());
+        auto results = storage_engine_.get_many(keys);
+
+        resp_append_array(reply, results.size());
+        for (const auto& result : results) {
+            if (result.first) {
+                resp_append_bulk(reply, result.second.name);
+            }
+            else {
+                resp_append_null(reply);
+            }
+        }
+    }
+
+    void handle_mset(const std::vector<std::string_view>& args, std::string& reply) {
+        if (args.size() % 2 == 0) {
+            resp_append_error(reply, "ERR wrong number of arguments for 'mset' command");
+            return;
+        }
+
+        std::vector<std::string> keys;
+        keys.reserve(args.size() / 2);
+        for (size_t i = 1; i < args.size(); i += 2) {
+            keys.emplace_back(args[i]);
+        }
+
+        for (const auto& key : keys) {
+            if (!CommandHandler::valid_user_key(key)) {
+                resp_append_error(reply, "ERR invalid id");
+                return;
+            }
+        }
+
+        // 在每个分片的一次加锁内原地修改，不会覆盖并发的INCRBY等修改
+        auto results = storage_engine_.update_many(keys, [&](size_t i, User& user) {
+            user.name = args[2 + i * 2];
+            return true;
+        }, [&](size_t i, User& user) { return CommandHandler::new_user(keys[i], user); });
+
+        bool stored = std::all_of(results.begin(), results.end(), [](StorageEngine::UpdateStatus status) {
+            return status == StorageEngine::UpdateStatus::UPDATED;
+        });
+        if (stored) {
+            resp_append_simple(reply, "OK");
+        }
+        else {
+            resp_append_error(reply, "ERR store failed");
+        }
+    }
+
+    void handle_hset(const std::vector<std::string_view>& args, std::string& reply) {
+        if (args.size() % 2 != 0) {
+            resp_append_error(reply, "ERR wrong number of arguments for 'hset' command");
+            return;
+        }
+
+        // 先校验全部字段，出错时不做任何修改
+        std::vector<UserField> fields;
+        std::vector<long long> amounts;
+        fields.reserve((args.size() - 2) / 2);
+        amounts.reserve((args.size() - 2) / 2);
+        for (size_t i = 2; i < args.size(); i += 2) {
+            UserField field = find_field(args[i]);
+            long long cash = 0;
+            switch (field) {
+            case UserField::NAME:
+            case UserField::EMAIL:
+            case UserField::PHONE:
+                break;
+            case UserField::CASH:
+                if (!parse_integer(args[i + 1], cash)) {
+                    resp_append_error(reply, "ERR value is not an integer or out of range");
+                    return;
+                }
+                break;
+            default:
+                resp_append_error(reply, "ERR unknown field, expected name, email, phone or cash");
+                return;
+            }
+            fields.push_back(field);
+            amounts.push_back(cash);
+        }
+
+        auto apply = [&](User& user) {
+            for (size_t k = 0; k < fields.size(); k++) {
+                std::string_view value = args[3 + k * 2];
+                switch (fields[k]) {
+                case UserField::NAME:
+                    user.name = value;
+                    break;
+                case UserField::EMAIL:
+                    user.email = value;
+                    break;
+                case UserField::PHONE:
+                    user.phone = value;
+                    break;
+                default:
+                    user.cash = amounts[k];
+                    break;
+                }
+            }
+            return true;
+        };
+        if (update_or_create(std::string(args[1]), apply, reply)) {
+            resp_append_integer(reply, static_cast<long long>(fields.size()));
+        }
+    }
+
+    void handle_hgetall(const std::vector<std::string_view>& args, std::string& reply) {
+        auto result = storage_engine_.get(std::string(args[1]));
+        if (!result.first) {
+            resp_append_array(reply, 0);
+            return;
+        }
+
+        const User& user = result.second;
+        char id[16];
+        char cash[24];
+        auto id_end = std::to_chars(id, id + sizeof(id), user.id).ptr;
+        auto cash_end = std::to_chars(cash, cash + sizeof(cash), user.cash).ptr;
+
+        resp_append_array(reply, 10);
+        resp_append_bulk(reply, "id");
+        resp_append_bulk(reply, std::string_view(id, id_end - id));
+        resp_append_bulk(reply, "name");
+        resp_append_bulk(reply, user.name);
+        resp_append_bulk(reply, "email");
+        resp_append_bulk(reply, user.email);
+        resp_append_bulk(reply, "phone");
+        resp_append_bulk(reply, user.phone);
+        resp_append_bulk(reply, "cash");
+        resp_append_bulk(reply, std::string_view(cash, cash_end - cash));
+    }
+
+    void handle_incrby(const std::vector<std::string_view>& args, std::string& reply) {
+        long long delta = 0;
+        if (!parse_integer(args[2], delta)) {
+            resp_append_error(reply, "ERR value is not an integer or out of range");
+            return;
+        }
+
+        // 一次加锁内原地修改，并发的INCRBY不会互相覆盖
+        std::string_view key = args[1];
+        long long cash = 0;
+        auto status = storage_engine_.add_cash(std::string(key), delta, cash,
+            [key](User& user) { return CommandHandler::new_user(key, user); });
+
+        switch (status) {
+        case StorageEngine::UpdateStatus::UPDATED:
+            resp_append_integer(reply, cash);
+            break;
+        case StorageEngine::UpdateStatus::NOT_FOUND:
+            resp_append_error(reply, "ERR invalid id");
+            break;
+        case StorageEngine::UpdateStatus::REJECTED:
+            resp_append_error(reply, "ERR increment or decrement would overflow");
+            break;
+        default:
+            resp_append_error(reply, "ERR store failed");
+            break;
+        }
+    }
+
+    void execute(const std::vector<std::string_view>& args, std::string& reply) {
+        const CommandEntry* entry = nullptr;
+        for (const CommandEntry& e : COMMANDS) {
+            if (resp_command_is(args[0], e.name)) {
+                entry = &e;
+                break;
+            }
+        }
+
+        if (!entry) {
+            reply += "-ERR unknown command '";
+            reply.append(args[0].data(), args[0].size());
+            reply += "'\r\n";
+            return;
+        }
+
+        int argc = static_cast<int>(args.size());
+        if ((entry->arity > 0 && argc != entry->arity) || (entry->arity < 0 && argc < -entry->arity)) {
+            reply += "-ERR wrong number of arguments for '";
+            reply.append(args[0].data(), args[0].size());
+            reply += "' command\r\n";
+            return;
+        }
+
+        switch (entry->command) {
+        case Command::GET:     handle_get(args, reply); break;
+        case Command::SET:     handle_set(args, reply); break;
+        case Command::DEL:     handle_del(args, reply); break;
+        case Command::MGET:    handle_mget(args, reply); break;
+        case Command::MSET:    handle_mset(args, reply); break;
+        case Command::HSET:    handle_hset(args, reply); break;
+        case Command::HGETALL: handle_hgetall(args, reply); break;
+        case Command::INCRBY:  handle_incrby(args, reply); break;
+        case Command::PING:
+            if (argc > 1) {
+                resp_append_bulk(reply, args[1]);
+            }
+            else {
+                resp_append_simple(reply, "PONG");
+            }
+            break;
+        }
+    }
+
+    // 依次执行data中的完整请求，回复追加到reply，返回处理的字节数；协议错误时error为true。
+    // 只访问存储引擎，可以在工作线程中调用
+    size_t process_requests(const char* data, size_t len, std::vector<std::string_view>& args,
+                            std::string& reply, bool& error) {
+        size_t consumed = 0;
+        error = false;
+        while (consumed < len) {
+            size_t used = 0;
+            RespStatus status = parse_resp_request(data + consumed, len - consumed, args, used);
+            if (status == RespStatus::INCOMPLETE) {
+                break;
+            }
+            if (status == RespStatus::PROTOCOL_ERROR) {
+                resp_append_error(reply, "ERR Protocol error");
+                error = true;
+                break;
+            }
+            consumed += used;
+            if (!args.empty()) {
+                execute(args, reply);
+            }
+        }
+        return consumed;
+    }
+
+public:
+    RespHandler(NetworkServer* server, StorageEngine& storage)
+        : server_(server), storage_engine_(storage) {}
+
+    void on_connected(int client_fd, const sockaddr_in& addr) override {
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+        LOG_INFO("[连接] fd=" << client_fd
+            << ", IP=" << ip
+            << ", 端口=" << ntohs(addr.sin_port) << " (RESP)");
+    }
+
+    size_t on_data(int client_fd, const char* data, size_t len) override {
+        if (server_ && server_->has_workers()) {
+            // 工作线程模式：事件循环只切出完整的请求，执行交给工作线程
+            size_t complete = 0;
+            RespStatus status = RespStatus::COMPLETE;
+            while (complete < len) {
+                size_t used = 0;
+                status = parse_resp_request(data + complete, len - complete, args_, used);
+                if (status != RespStatus::COMPLETE) break;
+                complete += used;
+            }
+            if (status == RespStatus::PROTOCOL_ERROR) {
+                // 出错的部分也交给工作线程，让错误回复排在之前请求的回复后面
+                complete = len;
+            }
+            if (complete > 0) {
+                std::string batch(data, complete);
+                bool submitted = server_->offload(client_fd, [this, batch = std::move(batch)]() {
+                    std::vector<std::string_view> args;
+                    std::string reply;
+                    bool error = false;
+                    process_requests(batch.data(), batch.size(), args, reply, error);
+                    return reply;
+                });
+                if (!submitted) {
+                    // 工作线程队列满：请求留在输入缓冲区，服务器稍后重新调用on_data
+                    return 0;
+                }
+            }
+            if (status == RespStatus::PROTOCOL_ERROR) {
+                LOG_WARN("[错误] fd=" << client_fd << " RESP协议错误，断开连接");
+                server_->disconnect_after_flush(client_fd);
+            }
+            return complete;
+        }
+
+        std::string reply;
+        bool error = false;
+        size_t consumed = process_requests(data, len, args_, reply, error);
+        if (server_ && !reply.empty()) {
+            server_->send(client_fd, reply);
+        }
+        if (error) {
+            LOG_WARN("[错误] fd=" << client_fd << " RESP协议错误，断开连接");
+            if (server_) {
+                // 先把错误回复发出去再关闭
+                server_->disconnect_after_flush(client_fd);
+            }
+            return len;
+        }
+        return consumed;
+    }
+
+    void on_closed(int client_fd) override {
+        LOG_INFO("[断开] fd=" << client_fd);
+    }
+
+    bool send_data(int client_fd, const char* data, size_t len) override {
+        if (server_) {
+            return server_->send(client_fd, data, len);
+        }
+        return false;
+    }
+
+    void set_server(NetworkServer* server) {
+        server_ = server;
+    }
+};
@@ -1,69 +1,260 @@
 // storage_engine.hpp
 #pragma once
 #include "hash.h"
+#include "swiss.h"
 #include "lru.h"
+#include "clock.h"
+#include <algorithm>
+#include <climits>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ̭ԣLRUÿжҪҲжռ
+// CLOCKʱֻλλڹ½У̭˳LRUĽ
+enum class EvictionPolicy {
+    LRU,
+    CLOCK
+};
 
-class StorageEngine {
-private:
-    std::unique_ptr<IntrusiveHashTable> hash_table;
-    std::unique_ptr<IntrusiveLRU> lru_cache;
-    bool use_lru;
-    mutable std::mutex mtx;  // ̰߳ȫ
-
+// 洢档HashTableΪƬʹõĹϣҪṩIntrusiveHashTableͬĽӿ
+// insert/find/remove/clear/rehash/get_size/get_capacity/get_load_factorӵнڵ㣩
+template<typename HashTable = IntrusiveHashTable>
+class BasicStorageEngine {
 public:
-    StorageEngine(int hash_capacity = 1024, int lru_capacity = 100, bool enable_lru = true)
-        : use_lru(enable_lru) {
-        hash_table = std::make_unique<IntrusiveHashTable>(hash_capacity);
-        if (use_lru) {
-            lru_cache = std::make_unique<IntrusiveLRU>(lru_capacity);
-        }
-    }
-
-    // ¼ֵ
-    bool set(const std::string& key, const User& value) {
-        std::lock_guard<std::mutex> lock(mtx);
+    static const int DEFAULT_SHARDS = 16;
 
-        if (use_lru && lru_cache) {
-            DataNode* evicted = lru_cache->put(key, value);
+private:
+    // һƬĹϣ̭ṹж룬ͬƬͬһ
+    struct alignas(64) Shard {
+        std::unique_ptr<HashTable> hash_table;
+        std::unique_ptr<IntrusiveLRU> lru_cache;      // EvictionPolicy::LRU
+        std::unique_ptr<ClockCache> clock_cache;      // EvictionPolicy::CLOCK
+        bool use_lru = false;
+        mutable std::shared_mutex mtx;  // ̰߳ȫ
+
+        // ǷֻCLOCK̭ʱfind_locked޸κνṹй
+        bool shared_reads() const {
+            return !lru_cache;
+        }
 
-            // LRU˽ڵ㣬ӹϣɾ
-            if (evicted) {
-                DataNode* removed = hash_table->remove(evicted->key);
-                if (removed != evicted) {
-                    // ӦòᷢΪ˰ȫ
-                    delete evicted;
+        // ɳmtxĵ÷ʹãfind_lockedshared_reads()ʱֻҪ
+        bool set_locked(const std::string& key, const User& value) {
+            if (use_lru && clock_cache) {
+                DataNode* node = hash_table->find(key);
+                if (node) {
+                    node->value = value;
+                    ClockCache::touch(node);
+                    return true;
                 }
-                else {
+
+                node = new DataNode(key, value);
+                hash_table->insert(node);
+                DataNode* evicted = clock_cache->insert(node);
+                if (evicted) {
+                    hash_table->remove(evicted->key);
                     delete evicted;
                 }
+                return true;
             }
+            else if (use_lru && lru_cache) {
+                DataNode* evicted = lru_cache->put(key, value);
+
+                // LRU˽ڵ㣬ӹϣɾ
+                if (evicted) {
+                    DataNode* removed = hash_table->remove(evicted->key);
+                    if (removed != evicted) {
+                        // ӦòᷢΪ˰ȫ
+                        delete evicted;
+                    }
+                    else {
+                        delete evicted;
+                    }
+                }
 
-            // ȡLRUеĽڵ㣨´ģҲѴڵģ
-            DataNode* node = lru_cache->get(key);
-            if (node) {
-                // 뵽ϣ
+                // ȡLRUеĽڵ㣨´ģҲѴڵģ
+                DataNode* node = lru_cache->get(key);
+                if (node) {
+                    // 뵽ϣ
+                    DataNode* replaced = hash_table->insert(node);
+                    if (replaced && replaced != node) {
+                        // 滻ڵ㣬ɾ
+                        delete replaced;
+                    }
+                    return true;
+                }
+            }
+            else {
+                // ʹLRUֱӴڵ㲢ϣ
+                DataNode* node = new DataNode(key, value);
                 DataNode* replaced = hash_table->insert(node);
                 if (replaced && replaced != node) {
-                    // 滻ڵ㣬ɾ
                     delete replaced;
                 }
                 return true;
             }
+
+            return false;
+        }
+
+        // رkeyǰֵĽڵ㣬ʱnullptrɵ÷ֱӴӽڵ㿽ֵмʱ
+        DataNode* find_locked(const std::string& key) {
+            if (use_lru && clock_cache) {
+                DataNode* node = hash_table->find(key);
+                if (node) {
+                    ClockCache::touch(node);
+                }
+                return node;
+            }
+
+            // LRUв
+            if (use_lru && lru_cache) {
+                DataNode* lru_node = lru_cache->get(key);
+                if (lru_node) {
+                    // LRUҵҲһڹϣ
+                    return lru_node;
+                }
+            }
+
+            // ڹϣв
+            DataNode* hash_node = hash_table->find(key);
+            if (hash_node && use_lru && lru_cache) {
+                // LRUܻᴥ̭ùϣΪָLRUеĽڵ㣺
+                // ߱ͬһڵ㣬updateԭ޸ĵֵ֮
+                User value = hash_node->value;
+                return set_locked(key, value) ? lru_cache->get(key) : nullptr;
+            }
+            return hash_node;
+        }
+    };
+
+    static std::pair<bool, User> copy_result(const DataNode* node) {
+        if (node) {
+            return { true, node->value };
+        }
+        return { false, User(-1) };
+    }
+
+    std::unique_ptr<Shard[]> shards_;
+    size_t shard_mask_ = 0;
+    bool use_lru;
+    EvictionPolicy policy_;
+
+    // keyĹϣѡƬùϣֵĸ32λϣõλѡͰƬڵͰֲӰ
+    size_t shard_index(const std::string& key) const {
+        return static_cast<size_t>(hash_key(key) >> 32) & shard_mask_;
+    }
+
+    Shard& shard_for(const std::string& key) const {
+        return shards_[shard_index(key)];
+    }
+
+    // зƬִbodyread_onlyҷƬʱֻӹ
+    template<typename Body>
+    static void run_locked(Shard& shard, bool read_only, Body&& body) {
+        if (read_only && shard.shared_reads()) {
+            std::shared_lock<std::shared_mutex> lock(shard.mtx);
+            body();
         }
         else {
-            // ʹLRUֱӴڵ㲢ϣ
-            DataNode* node = new DataNode(key, value);
-            DataNode* replaced = hash_table->insert(node);
-            if (replaced && replaced != node) {
-                delete replaced;
+            std::lock_guard<std::shared_mutex> lock(shard.mtx);
+            body();
+        }
+    }
+
+    // countkeyƬεfn(shard, i)ÿƬֻһ
+    template<typename KeyOf, typename Fn>
+    void for_each_by_shard(size_t count, bool read_only, KeyOf&& key_of, Fn&& fn) {
+        if (shard_mask_ == 0) {
+            run_locked(shards_[0], read_only, [&]() {
+                for (size_t i = 0; i < count; i++) {
+                    fn(shards_[0], i);
+                }
+            });
+            return;
+        }
+
+        // bounds[s]bounds[s+1]ǵsƬkeyorderеķΧ
+        size_t shard_count = shard_mask_ + 1;
+        std::vector<size_t> shard_of(count);
+        std::vector<size_t> bounds(shard_count + 1, 0);
+        for (size_t i = 0; i < count; i++) {
+            shard_of[i] = shard_index(key_of(i));
+            bounds[shard_of[i] + 1]++;
+        }
+        for (size_t s = 0; s < shard_count; s++) {
+            bounds[s + 1] += bounds[s];
+        }
+        std::vector<size_t> order(count);
+        std::vector<size_t> next(bounds.begin(), bounds.end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            order[next[shard_of[i]]++] = i;
+        }
+
+        for (size_t s = 0; s < shard_count; s++) {
+            if (bounds[s] == bounds[s + 1]) {
+                continue;
             }
-            return true;
+            run_locked(shards_[s], read_only, [&]() {
+                for (size_t k = bounds[s]; k < bounds[s + 1]; k++) {
+                    fn(shards_[s], order[k]);
+                }
+            });
         }
+    }
 
-        return false;
+public:
+    // shard_countȡΪ2ݣƽָƬ̭СڷƬʱƬӦ١
+    // ÿƬ̭һƬʱLRU˳ֻڷƬϸġpolicyֻenable_lruʱЧ
+    BasicStorageEngine(int hash_capacity = 1024, int lru_capacity = 100, bool enable_lru = true,
+        int shard_count = DEFAULT_SHARDS, EvictionPolicy policy = EvictionPolicy::LRU)
+        : use_lru(enable_lru), policy_(policy) {
+        int count = 1;
+        while (count < shard_count) {
+            count <<= 1;
+        }
+        // ÿƬҪ1λãᱻŴ
+        while (use_lru && count > 1 && count > lru_capacity) {
+            count >>= 1;
+        }
+        shards_.reset(new Shard[count]);
+        shard_mask_ = static_cast<size_t>(count - 1);
+
+        // Ƭȷзָ֣ǰķƬ
+        int shard_hash_capacity = std::max(1, (hash_capacity + count - 1) / count);
+        int lru_base = lru_capacity / count;
+        int lru_extra = lru_capacity % count;
+        for (int i = 0; i < count; i++) {
+            int shard_lru_capacity = std::max(1, lru_base + (i < lru_extra ? 1 : 0));
+            Shard& shard = shards_[i];
+            shard.use_lru = use_lru;
+            shard.hash_table = std::make_unique<HashTable>(shard_hash_capacity);
+            if (use_lru && policy == EvictionPolicy::CLOCK) {
+                shard.clock_cache = std::make_unique<ClockCache>(shard_lru_capacity);
+            }
+            else if (use_lru) {
+                shard.lru_cache = std::make_unique<IntrusiveLRU>(shard_lru_capacity);
+            }
+        }
+    }
+
+    size_t shard_count() const {
+        return shard_mask_ + 1;
+    }
+
+    EvictionPolicy eviction_policy() const {
+        return policy_;
+    }
+
+    // ¼ֵ
+    bool set(const std::string& key, const User& value) {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::shared_mutex> lock(shard.mtx);
+        return shard.set_locked(key, value);
     }
 
     //// ȡֵ
@@ -87,54 +278,152 @@ public:
     //    return { false, User(-1) };
     //}
     std::pair<bool, User> get(const std::string& key) {
-        std::lock_guard<std::mutex> lock(mtx);
-
-        // LRUв
-        if (use_lru && lru_cache) {
-            DataNode* lru_node = lru_cache->get(key);
-            if (lru_node) {
-                // LRUҵҲһڹϣ
-                return { true, lru_node->value };
-            }
+        Shard& shard = shard_for(key);
+        if (shard.shared_reads()) {
+            std::shared_lock<std::shared_mutex> lock(shard.mtx);
+            return copy_result(shard.find_locked(key));
         }
 
-        // ڹϣв
-        DataNode* hash_node = hash_table->find(key);
-        if (hash_node) {
-            if (use_lru && lru_cache) {
-                // ӹϣȡڵ㣬LRU
-                DataNode* removed = hash_table->remove(key);
-                if (removed) {
-                    // LRUܻᴥ̭
-                    DataNode* evicted = lru_cache->put(key, removed->value);
-                    if (evicted) {
-                        // ӹϣɾĽڵ
-                        hash_table->remove(evicted->key);
-                        delete evicted;
-                    }
-                    // ڵ²ϣ
-                    DataNode* replaced = hash_table->insert(removed);
-                    if (replaced && replaced != removed) {
-                        delete replaced;
-                    }
+        std::lock_guard<std::shared_mutex> lock(shard.mtx);
+        return copy_result(shard.find_locked(key));
+    }
+
+    // ȡÿƬֻһkeysһһӦδҵΪ{ false, User(-1) }
+    std::vector<std::pair<bool, User>> get_many(const std::vector<std::string>& keys) {
+        std::vector<std::pair<bool, User>> results(keys.size(), std::make_pair(false, User(-1)));
+
+        for_each_by_shard(keys.size(), true, [&](size_t i) -> const std::string& { return keys[i]; },
+            [&](Shard& shard, size_t i) {
+                DataNode* node = shard.find_locked(keys[i]);
+                if (node) {
+                    results[i] = { true, node->value };
                 }
-            }
-            return { true, hash_node->value };
+            });
+        return results;
+    }
+
+    // £ÿƬֻһسɹдĸ
+    size_t set_many(const std::vector<std::pair<std::string, User>>& items) {
+        size_t stored = 0;
+
+        for_each_by_shard(items.size(), false, [&](size_t i) -> const std::string& { return items[i].first; },
+            [&](Shard& shard, size_t i) {
+                if (shard.set_locked(items[i].first, items[i].second)) {
+                    stored++;
+                }
+            });
+        return stored;
+    }
+
+    // ԭض--дĽ
+    enum class UpdateStatus {
+        UPDATED,
+        NOT_FOUND,   // keyڣinitûдֵ
+        REJECTED,    // fnܾ޸
+        FAILED       // ֵʧ
+    };
+
+private:
+    // updateʵ֣÷shardĶռ
+    template<typename Fn, typename Init>
+    static UpdateStatus update_locked(Shard& shard, const std::string& key, Fn&& fn, Init&& init) {
+        DataNode* node = shard.find_locked(key);
+        if (node) {
+            return fn(node->value) ? UpdateStatus::UPDATED : UpdateStatus::REJECTED;
         }
 
-        return { false, User(-1) };
+        User value;
+        if (!init(value)) {
+            return UpdateStatus::NOT_FOUND;
+        }
+        if (!fn(value)) {
+            return UpdateStatus::REJECTED;
+        }
+        return shard.set_locked(key, value) ? UpdateStatus::UPDATED : UpdateStatus::FAILED;
+    }
+
+public:
+    // һμԭ޸keyֵfn(User&)falseʾܾ޸ģʱܸĶֵ
+    // keyʱȵinit(User&)ֵinittrueִfn
+    template<typename Fn, typename Init>
+    UpdateStatus update(const std::string& key, Fn&& fn, Init&& init) {
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::shared_mutex> lock(shard.mtx);
+        return update_locked(shard, key, fn, init);
+    }
+
+    // ԭ޸ģÿƬֻһÿkeyupdateͬ
+    // fn(i, User&)޸ĵikeykeyʱȵinit(i, User&)keysһһӦĽ
+    template<typename Fn, typename Init>
+    std::vector<UpdateStatus> update_many(const std::vector<std::string>& keys, Fn&& fn, Init&& init) {
+        std::vector<UpdateStatus> results(keys.size(), UpdateStatus::NOT_FOUND);
+
+        for_each_by_shard(keys.size(), false, [&](size_t i) -> const std::string& { return keys[i]; },
+            [&](Shard& shard, size_t i) {
+                results[i] = update_locked(shard, keys[i],
+                    [&](User& user) { return fn(i, user); },
+                    [&](User& user) { return init(i, user); });
+            });
+        return results;
+    }
+
+    // ֻ޸Ѵڵkey
+    template<typename Fn>
+    UpdateStatus update(const std::string& key, Fn&& fn) {
+        return update(key, std::forward<Fn>(fn), [](User&) { return false; });
+    }
+
+    // ԭӵؼdeltaΪȡbalance޸ĺʱܾbalanceΪǰ
+    template<typename Init>
+    UpdateStatus add_cash(const std::string& key, long long delta, long long& balance, Init&& init) {
+        return update(key, [&](User& user) {
+            if ((delta > 0 && user.cash > LLONG_MAX - delta) ||
+                (delta < 0 && user.cash < LLONG_MIN - delta)) {
+                balance = user.cash;
+                return false;
+            }
+            user.cash += delta;
+            balance = user.cash;
+            return true;
+        }, std::forward<Init>(init));
+    }
+
+    UpdateStatus add_cash(const std::string& key, long long delta, long long& balance) {
+        return add_cash(key, delta, balance, [](User&) { return false; });
+    }
+
+    // expectedʱΪdesiredcurrent޸ĺ󣨻ʱĵǰ
+    UpdateStatus compare_and_set_cash(const std::string& key, long long expected,
+        long long desired, long long& current) {
+        return update(key, [&](User& user) {
+            if (user.cash != expected) {
+                current = user.cash;
+                return false;
+            }
+            user.cash = desired;
+            current = desired;
+            return true;
+        });
     }
 
     // ɾֵ
     bool del(const std::string& key) {
-        std::lock_guard<std::mutex> lock(mtx);
+        Shard& shard = shard_for(key);
+        std::lock_guard<std::shared_mutex> lock(shard.mtx);
 
         // ӹϣɾ
-        DataNode* hash_node = hash_table->remove(key);
+        DataNode* hash_node = shard.hash_table->remove(key);
 
-        if (use_lru && lru_cache) {
+        if (use_lru && shard.clock_cache) {
+            if (hash_node) {
+                shard.clock_cache->remove(hash_node);
+                delete hash_node;
+                return true;
+            }
+        }
+        else if (use_lru && shard.lru_cache) {
             // LRUɾ
-            DataNode* lru_node = lru_cache->remove(key);
+            DataNode* lru_node = shard.lru_cache->remove(key);
 
             // ɾڵ
             if (hash_node) {
@@ -156,41 +445,89 @@ public:
         return false;
     }
 
+    // ǨƬݺûľͰÿƬcount¼ѭʱã
+    // ðǨ֮⡣Ƭռʱ̡߳ǷзƬû
+    bool rehash(int count) {
+        bool pending = false;
+        for (size_t i = 0; i <= shard_mask_; i++) {
+            Shard& shard = shards_[i];
+            std::unique_lock<std::shared_mutex> lock(shard.mtx, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                pending = true;
+                continue;
+            }
+            if (shard.hash_table->rehash(count)) {
+                pending = true;
+            }
+        }
+        return pending;
+    }
+
     // ȡͳϢ
+    // ȡͳϢƬ֮ͣ
     void get_stats() const {
-        std::lock_guard<std::mutex> lock(mtx);
+        long long hash_capacity = 0;
+        long long hash_size = 0;
+        long long lru_capacity = 0;
+        long long lru_size = 0;
+        for (size_t i = 0; i <= shard_mask_; i++) {
+            const Shard& shard = shards_[i];
+            std::shared_lock<std::shared_mutex> lock(shard.mtx);
+            hash_capacity += shard.hash_table->get_capacity();
+            hash_size += shard.hash_table->get_size();
+            if (use_lru && shard.lru_cache) {
+                lru_capacity += shard.lru_cache->get_capacity();
+                lru_size += shard.lru_cache->get_size();
+            }
+            if (use_lru && shard.clock_cache) {
+                lru_capacity += shard.clock_cache->get_capacity();
+                lru_size += shard.clock_cache->get_size();
+            }
+        }
 
         std::cout << "=== 洢ͳ ===" << std::endl;
-        std::cout << "ϣ: " << hash_table->get_capacity() << std::endl;
-        std::cout << "ϣС: " << hash_table->get_size() << std::endl;
-        std::cout << "ϣ: " << hash_table->get_load_factor() << std::endl;
+        std::cout << "Ƭ: " << shard_count() << std::endl;
+        std::cout << "ϣ: " << hash_capacity << std::endl;
+        std::cout << "ϣС: " << hash_size << std::endl;
+        std::cout << "ϣ: " << static_cast<double>(hash_size) / hash_capacity << std::endl;
 
-        if (use_lru && lru_cache) {
-            std::cout << "LRU: " << lru_cache->get_capacity() << std::endl;
-            std::cout << "LRUС: " << lru_cache->get_size() << std::endl;
+        if (use_lru) {
+            std::cout << "̭: " << (policy_ == EvictionPolicy::CLOCK ? "CLOCK" : "LRU") << std::endl;
+            std::cout << "LRU: " << lru_capacity << std::endl;
+            std::cout << "LRUС: " << lru_size << std::endl;
         }
     }
 
     // 
     void clear() {
-        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i <= shard_mask_; i++) {
+            Shard& shard = shards_[i];
+            std::lock_guard<std::shared_mutex> lock(shard.mtx);
 
-        hash_table->clear();
-        if (use_lru && lru_cache) {
-            lru_cache->clear();
+            shard.hash_table->clear();
+            if (use_lru && shard.lru_cache) {
+                shard.lru_cache->clear();
+            }
+            if (use_lru && shard.clock_cache) {
+                shard.clock_cache->clear();
+            }
         }
     }
 };
 
+using StorageEngine = BasicStorageEngine<IntrusiveHashTable>;
+using SwissStorageEngine = BasicStorageEngine<SwissHashTable>;
+
 // Ժ
 void test_basic_operations();
 void test_lru_eviction();
+void test_clock_eviction();
 void test_performance();
 
 // 1: 
 void test_basic_operations() {
-    std::cout << "洢(ϣ=10, LRU=5)...\n";
-    StorageEngine storage(10, 5, true);
+    std::cout << "洢(ϣ=10, LRU=5, Ƭ)...\n";
+    StorageEngine storage(10, 5, true, 1);
 
     // 
     std::cout << "5û...\n";
@@ -267,8 +604,8 @@ void test_basic_operations() {
 
 // 2: LRṶԲ
 void test_lru_eviction() {
-    std::cout << "洢(ϣ=20, LRU=3)...\n";
-    StorageEngine storage(20, 3, true);
+    std::cout << "洢(ϣ=20, LRU=3, Ƭ)...\n";
+    StorageEngine storage(20, 3, true, 1);
 
     // 3ûLRUΪ3
     std::cout << "3û(LRU):\n";
@@ -326,6 +663,46 @@ void test_lru_eviction() {
     storage.get_stats();
 }
 
+// 2b: CLOCK̭Բ
+void test_clock_eviction() {
+    std::cout << "洢(ϣ=20, CLOCK=3, Ƭ)...\n";
+    StorageEngine storage(20, 3, true, 1, EvictionPolicy::CLOCK);
+
+    std::cout << "ABC()ֻA...\n";
+    storage.set("A", User(1, "ûA", 100));
+    storage.set("B", User(2, "ûB", 200));
+    storage.set("C", User(3, "ûC", 300));
+    storage.get("A");
+
+    // Aλõڶλ᣻BǵһûбʹĽڵ
+    std::cout << "ûD(ᴥCLOCK̭)...\n";
+    storage.set("D", User(4, "ûD", 400));
+
+    bool a = storage.get("A").first;
+    bool b = storage.get("B").first;
+    bool c = storage.get("C").first;
+    bool d = storage.get("D").first;
+    if (a && !b && c && d) {
+        std::cout << "\n CLOCK̭ȷ: B̭A,C,D\n";
+    }
+    else {
+        std::cout << "\n CLOCK̭Դ\n";
+    }
+
+    // ɾٲ벻Ӧ̭
+    storage.del("C");
+    storage.set("E", User(5, "ûE", 500));
+    if (storage.get("A").first && storage.get("D").first && storage.get("E").first) {
+        std::cout << " ɾ벻̭ڵ\n";
+    }
+    else {
+        std::cout << " ɾ̭ڵ\n";
+    }
+
+    std::cout << "\nͳϢ:\n";
+    storage.get_stats();
+}
+
 // 3: ܲ
 void test_performance() {
     const int NUM_OPERATIONS = 10000;
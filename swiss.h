@@ -0,0 +1,250 @@
+//swiss.h
+#pragma once
+#include "config.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWISS_USE_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// 开放寻址哈希表（Swiss table）：与IntrusiveHashTable接口相同，可以作为StorageEngine的哈希表策略。
+// 每个槽位对应1字节控制字节：空、已删除（墓碑），或者key哈希值的低7位。
+// 槽位按16个一组，查找时用SSE2一次比较一组的控制字节，只有控制字节匹配的槽位才访问节点比较key；
+// 未命中的查找通常只读一组控制字节就结束，不会访问任何节点。
+// 与IntrusiveHashTable一样只保存节点指针，不拥有节点
+class SwissHashTable {
+private:
+    static const int GROUP_SIZE = 16;
+    static const int8_t CTRL_EMPTY = -128;    // 0x80
+    static const int8_t CTRL_DELETED = -2;    // 0xFE
+
+    // 控制字节和对应的节点指针放在一起，命中时读控制字节后紧接着读的指针通常在同一或相邻缓存行
+    struct alignas(16) Group {
+        int8_t ctrl[GROUP_SIZE];
+        DataNode* slots[GROUP_SIZE];
+    };
+
+    std::vector<Group> groups;
+    size_t group_mask = 0;
+    int capacity;
+    int size = 0;
+    int tombstones = 0;
+
+    // 哈希值（DataNode::hash或hash_key）的低7位作为控制字节，其余位选择组
+    static int8_t h2(uint64_t h) {
+        return static_cast<int8_t>(h & 0x7F);
+    }
+
+    static size_t h1(uint64_t h) {
+        return static_cast<size_t>(h >> 7);
+    }
+
+    static int lowest_bit(uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    // 组内控制字节等于value的槽位掩码，第i位对应第i个槽位
+    static uint32_t match(const Group& group, int8_t value) {
+#ifdef SWISS_USE_SSE2
+        __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(group.ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < GROUP_SIZE; i++) {
+            if (group.ctrl[i] == value) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    // 空槽或墓碑（控制字节最高位为1）的掩码
+    static uint32_t match_free(const Group& group) {
+#ifdef SWISS_USE_SSE2
+        __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(group.ctrl));
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+        uint32_t mask = 0;
+        for (int i = 0; i < GROUP_SIZE; i++) {
+            if (group.ctrl[i] < 0) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    // 返回key所在的槽位，不存在返回-1。探测按组进行，第i次跳过i组（三角数序列，能遍历所有组），
+    // 遇到含空槽的组说明key不可能在更后面
+    long find_slot(const std::string& key, uint64_t h) const {
+        size_t g = h1(h) & group_mask;
+        int8_t tag = h2(h);
+        for (size_t step = 1;; step++) {
+            const Group& group = groups[g];
+            for (uint32_t mask = match(group, tag); mask; mask &= mask - 1) {
+                int i = lowest_bit(mask);
+                if (group.slots[i]->hash == h && group.slots[i]->key == key) {
+                    return static_cast<long>(g * GROUP_SIZE + i);
+                }
+            }
+            if (match(group, CTRL_EMPTY)) {
+                return -1;
+            }
+            g = (g + step) & group_mask;
+        }
+    }
+
+    // 探测序列上第一个空槽或墓碑
+    size_t find_free(uint64_t h) const {
+        size_t g = h1(h) & group_mask;
+        for (size_t step = 1;; step++) {
+            uint32_t mask = match_free(groups[g]);
+            if (mask) {
+                return g * GROUP_SIZE + lowest_bit(mask);
+            }
+            g = (g + step) & group_mask;
+        }
+    }
+
+    DataNode*& slot_at(size_t slot) {
+        return groups[slot / GROUP_SIZE].slots[slot % GROUP_SIZE];
+    }
+
+    DataNode* slot_at(size_t slot) const {
+        return groups[slot / GROUP_SIZE].slots[slot % GROUP_SIZE];
+    }
+
+    void set_ctrl(size_t slot, int8_t value) {
+        groups[slot / GROUP_SIZE].ctrl[slot % GROUP_SIZE] = value;
+    }
+
+    int8_t get_ctrl(size_t slot) const {
+        return groups[slot / GROUP_SIZE].ctrl[slot % GROUP_SIZE];
+    }
+
+    void init(int new_capacity) {
+        capacity = GROUP_SIZE;
+        while (capacity < new_capacity) {
+            capacity <<= 1;
+        }
+        groups.assign(capacity / GROUP_SIZE, Group());
+        for (Group& group : groups) {
+            memset(group.ctrl, CTRL_EMPTY, GROUP_SIZE);
+        }
+        group_mask = groups.size() - 1;
+        size = 0;
+        tombstones = 0;
+    }
+
+    // 扩容时一次完成，没有需要在空闲时搬迁的旧数组
+    bool rehash(int) { return false; }
+
+public:
+    SwissHashTable(int cap = 16) {
+        init(cap);
+    }
+
+    // 插入节点（返回被替换的旧节点，如果没有则返回nullptr）
+    DataNode* insert(DataNode* node) {
+        if (!node) return nullptr;
+
+        uint64_t h = node->hash;
+        long existing = find_slot(node->key, h);
+        if (existing >= 0) {
+            DataNode* replaced = slot_at(existing);
+            slot_at(existing) = node;
+            if (replaced != node) {
+                replaced->hash_index = -1;
+            }
+            node->hash_index = static_cast<int>(existing);
+            return replaced;
+        }
+
+        // 最大负载7/8，墓碑也占用探测长度，一起计入
+        if ((size + tombstones + 1) * 8 > capacity * 7) {
+            resize(size * 2 >= capacity ? capacity * 2 : capacity);
+        }
+
+        size_t slot = find_free(h);
+        if (get_ctrl(slot) == CTRL_DELETED) {
+            tombstones--;
+        }
+        set_ctrl(slot, h2(h));
+        slot_at(slot) = node;
+        node->hash_index = static_cast<int>(slot);
+        size++;
+
+        return nullptr;
+    }
+
+    // 查找节点
+    DataNode* find(const std::string& key) const {
+        long slot = find_slot(key, hash_key(key));
+        return slot >= 0 ? slot_at(slot) : nullptr;
+    }
+
+    // 删除节点。组内还有空槽时查找不会越过这一组，槽位可以直接置空，否则留下墓碑
+    DataNode* remove(const std::string& key) {
+        long slot = find_slot(key, hash_key(key));
+        if (slot < 0) return nullptr;
+
+        DataNode* node = slot_at(slot);
+        slot_at(slot) = nullptr;
+        if (match(groups[slot / GROUP_SIZE], CTRL_EMPTY)) {
+            set_ctrl(slot, CTRL_EMPTY);
+        }
+        else {
+            set_ctrl(slot, CTRL_DELETED);
+            tombstones++;
+        }
+        node->hash_index = -1;
+        size--;
+        return node;
+    }
+
+    // 重建为new_capacity个槽位（同时清掉墓碑）
+    void resize(int new_capacity) {
+        std::vector<DataNode*> nodes;
+        nodes.reserve(size);
+        for (const Group& group : groups) {
+            for (int i = 0; i < GROUP_SIZE; i++) {
+                if (group.ctrl[i] >= 0) nodes.push_back(group.slots[i]);
+            }
+        }
+
+        init(new_capacity);
+        for (DataNode* node : nodes) {
+            uint64_t h = node->hash;
+            size_t slot = find_free(h);
+            set_ctrl(slot, h2(h));
+            slot_at(slot) = node;
+            node->hash_index = static_cast<int>(slot);
+        }
+        size = static_cast<int>(nodes.size());
+    }
+
+    // 清空（不删除节点）
+    void clear() {
+        for (Group& group : groups) {
+            memset(group.ctrl, CTRL_EMPTY, GROUP_SIZE);
+            std::fill(group.slots, group.slots + GROUP_SIZE, nullptr);
+        }
+        size = 0;
+        tombstones = 0;
+    }
+
+    int get_size() const { return size; }
+    int get_capacity() const { return capacity; }
+    double get_load_factor() const { return (double)size / capacity; }
+};
@@ -0,0 +1,247 @@
+//timer.h
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// 定时器句柄，0表示无效
+using TimerId = uint64_t;
+
+// 分层时间轮：第0层256个槽，每槽1个刻度(1ms)；第1~3层各64个槽，每槽覆盖下一层一整圈。
+// 插入和取消都是O(1)；高层的槽在下一层转完一圈时整体下放(cascade)。
+// 节点放在数组里用下标串成双向链表，句柄带代数，取消已触发或已取消的定时器是安全的。
+class TimerWheel {
+private:
+    static const int LEVEL0_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVEL0_SIZE = 1 << LEVEL0_BITS;
+    static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const int LEVELS = 4;
+    static const int NUM_SLOTS = LEVEL0_SIZE + (LEVELS - 1) * LEVEL_SIZE;
+    static const uint64_t MAX_DELTA = (1ULL << (LEVEL0_BITS + (LEVELS - 1) * LEVEL_BITS)) - 1;
+
+    struct Node {
+        uint64_t expire = 0;          // 到期刻度
+        uint64_t interval = 0;        // 周期定时器的间隔，0为一次性
+        std::function<void()> callback;
+        int prev = -1;
+        int next = -1;
+        int slot = -1;                // 所在槽，-1表示不在轮上
+        uint32_t generation = 0;
+        bool active = false;
+        bool running = false;         // 回调执行中
+        bool cancelled = false;       // 回调执行中被取消
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<int> free_list_;
+    int slots_[NUM_SLOTS];
+    uint64_t level0_bitmap_[LEVEL0_SIZE / 64] = {};
+    uint64_t current_ = 0;            // 下一个待处理的刻度
+    size_t count_ = 0;
+
+    static int slot_index(int level, uint64_t expire) {
+        if (level == 0) {
+            return static_cast<int>(expire & (LEVEL0_SIZE - 1));
+        }
+        int shift = LEVEL0_BITS + (level - 1) * LEVEL_BITS;
+        return LEVEL0_SIZE + (level - 1) * LEVEL_SIZE +
+               static_cast<int>((expire >> shift) & (LEVEL_SIZE - 1));
+    }
+
+    void link(int index) {
+        Node& node = nodes_[index];
+        uint64_t expire = node.expire < current_ ? current_ : node.expire;
+        uint64_t delta = expire - current_;
+        if (delta > MAX_DELTA) {
+            // 超出时间轮范围，先放在最高层，下放时再重新计算
+            expire = current_ + MAX_DELTA;
+            delta = MAX_DELTA;
+        }
+
+        int slot;
+        if (delta < LEVEL0_SIZE) {
+            slot = slot_index(0, expire);
+            level0_bitmap_[slot / 64] |= 1ULL << (slot % 64);
+        } else if (delta < (1ULL << (LEVEL0_BITS + LEVEL_BITS))) {
+            slot = slot_index(1, expire);
+        } else if (delta < (1ULL << (LEVEL0_BITS + 2 * LEVEL_BITS))) {
+            slot = slot_index(2, expire);
+        } else {
+            slot = slot_index(3, expire);
+        }
+
+        node.slot = slot;
+        node.prev = -1;
+        node.next = slots_[slot];
+        if (node.next != -1) {
+            nodes_[node.next].prev = index;
+        }
+        slots_[slot] = index;
+    }
+
+    void unlink(int index) {
+        Node& node = nodes_[index];
+        if (node.slot < 0) return;
+
+        if (node.prev != -1) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            slots_[node.slot] = node.next;
+            if (node.slot < LEVEL0_SIZE && node.next == -1) {
+                level0_bitmap_[node.slot / 64] &= ~(1ULL << (node.slot % 64));
+            }
+        }
+        if (node.next != -1) {
+            nodes_[node.next].prev = node.prev;
+        }
+        node.prev = node.next = -1;
+        node.slot = -1;
+    }
+
+    void release(int index) {
+        Node& node = nodes_[index];
+        node.active = false;
+        node.running = false;
+        node.cancelled = false;
+        node.callback = nullptr;
+        node.generation++;
+        free_list_.push_back(index);
+        count_--;
+    }
+
+    // 把高层的一个槽整体重新插入（会落到更低的层）
+    void cascade(int slot) {
+        int index = slots_[slot];
+        slots_[slot] = -1;
+        while (index != -1) {
+            int next = nodes_[index].next;
+            nodes_[index].slot = -1;
+            link(index);
+            index = next;
+        }
+    }
+
+    // 处理一个刻度
+    void tick() {
+        if ((current_ & (LEVEL0_SIZE - 1)) == 0) {
+            for (int level = 1; level < LEVELS; level++) {
+                int slot = slot_index(level, current_);
+                cascade(slot);
+                int shift = LEVEL0_BITS + (level - 1) * LEVEL_BITS;
+                if (((current_ >> shift) & (LEVEL_SIZE - 1)) != 0) break;
+            }
+        }
+
+        int slot = slot_index(0, current_);
+        while (slots_[slot] != -1) {
+            int index = slots_[slot];
+            unlink(index);
+            fire(index);
+        }
+        current_++;
+    }
+
+    void fire(int index) {
+        std::function<void()> callback = std::move(nodes_[index].callback);
+        nodes_[index].running = true;
+
+        callback();
+
+        // 回调中可能新增定时器导致nodes_扩容，重新取引用
+        Node& node = nodes_[index];
+        if (node.interval > 0 && !node.cancelled) {
+            node.running = false;
+            node.callback = std::move(callback);
+            node.expire = current_ + node.interval;
+            link(index);
+        } else {
+            release(index);
+        }
+    }
+
+public:
+    TimerWheel() {
+        for (int i = 0; i < NUM_SLOTS; i++) {
+            slots_[i] = -1;
+        }
+    }
+
+    // 添加定时器，expire和interval单位与advance的时间一致(ms)
+    TimerId add(uint64_t expire, uint64_t interval, std::function<void()> callback) {
+        int index;
+        if (!free_list_.empty()) {
+            index = free_list_.back();
+            free_list_.pop_back();
+        } else {
+            index = static_cast<int>(nodes_.size());
+            nodes_.emplace_back();
+        }
+
+        Node& node = nodes_[index];
+        node.expire = expire;
+        node.interval = interval;
+        node.callback = std::move(callback);
+        node.active = true;
+        link(index);
+        count_++;
+
+        return (static_cast<uint64_t>(node.generation) << 32) | static_cast<uint32_t>(index + 1);
+    }
+
+    // 取消定时器，已触发或已取消时返回false
+    bool cancel(TimerId id) {
+        if (id == 0) return false;
+        int index = static_cast<int>(static_cast<uint32_t>(id)) - 1;
+        uint32_t generation = static_cast<uint32_t>(id >> 32);
+        if (index < 0 || static_cast<size_t>(index) >= nodes_.size()) return false;
+
+        Node& node = nodes_[index];
+        if (!node.active || node.generation != generation) return false;
+
+        if (node.running) {
+            // 在自己的回调里取消，回调返回后释放
+            node.cancelled = true;
+            return true;
+        }
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    // 推进到now，执行所有到期的定时器
+    void advance(uint64_t now) {
+        if (count_ == 0) {
+            if (now >= current_) current_ = now + 1;
+            return;
+        }
+        while (current_ <= now) {
+            tick();
+        }
+    }
+
+    // 距下一次需要处理的时间(ms)，没有定时器时返回-1。
+    // 只有高层有定时器时返回下一次下放的时间，届时重新计算
+    int next_timeout(uint64_t now) const {
+        if (count_ == 0) return -1;
+        if (now >= current_ + LEVEL0_SIZE) return 0;
+
+        // 下一次下放的刻度；current_恰好在边界上时该刻度的下放还没有执行
+        uint64_t limit = (current_ + LEVEL0_SIZE - 1) & ~static_cast<uint64_t>(LEVEL0_SIZE - 1);
+        // 从current_开始扫描：current_到now之间的刻度还没有处理，其中的定时器已经到期
+        for (uint64_t t = current_; t < limit; ) {
+            int slot = static_cast<int>(t & (LEVEL0_SIZE - 1));
+            uint64_t word = level0_bitmap_[slot / 64] >> (slot % 64);
+            if (word) {
+                t += __builtin_ctzll(word);
+                if (t >= limit) break;
+                return t > now ? static_cast<int>(t - now) : 0;
+            }
+            t += 64 - (slot % 64);
+        }
+        // now已越过下放刻度时下放已到期，必须返回0而不是负数（负数在poll/epoll中表示无限等待）
+        return limit > now ? static_cast<int>(limit - now) : 0;
+    }
+
+    size_t size() const { return count_; }
+};
@@ -0,0 +1,554 @@
+//uring_loop.h
+#pragma once
+#include "network.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <ctime>
+#include <cstring>
+#include <stdexcept>
+#include <memory>
+#include <string>
+#include <vector>
+
+// io_uring事件循环（完成式I/O）
+// 监听socket使用accept（每次完成后重新提交，以便带回对端地址），客户端使用multishot recv + 提供缓冲区环(provided buffer ring)，
+// 发送请求在处理事件时只放入提交队列，下一次io_uring_enter时与等待完成合并为一次系统调用。
+// 普通fd（add_event）用multishot poll模拟就绪通知。
+class UringLoop : public EventLoop {
+private:
+    static const unsigned RING_ENTRIES = 4096;
+    static const unsigned BUF_COUNT = 1024;      // 提供缓冲区数量（2的幂）
+    static const unsigned BUF_SIZE = 4096;
+    static const unsigned BUF_GROUP = 0;
+    static const int MAX_SEND_IOV = 64;
+
+    // user_data编码：低3位为操作类型；发送请求的高位是EventHandler指针（8字节对齐），
+    // 其余请求为 | 代数(32位) | fd(29位) | 操作(3位) |
+    enum Op : uint8_t {
+        OP_ACCEPT = 1,
+        OP_RECV = 2,
+        OP_SEND = 3,
+        OP_POLL = 4,
+        OP_CANCEL = 5
+    };
+
+    // 每个fd的登记信息，按fd下标存放；提交后内核会读写其中的字段，地址必须固定
+    struct Slot {
+        EventHandler* handler = nullptr;
+        uint32_t generation = 0;     // fd关闭后递增，用于丢弃旧请求的完成事件
+        Op op = OP_POLL;             // 该fd上常驻的multishot请求类型
+        uint32_t poll_mask = 0;
+        msghdr msg{};                // 发送中的请求参数，完成前必须保持有效
+        iovec iov[MAX_SEND_IOV];
+        sockaddr_in accept_addr{};   // 接受请求写回的对端地址
+        socklen_t accept_len = 0;
+    };
+
+    int ring_fd_{-1};
+
+    // 提交队列
+    void* sq_ptr_{nullptr};
+    size_t sq_size_{0};
+    unsigned* sq_head_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned* sq_array_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    io_uring_sqe* sqes_{nullptr};
+    size_t sqes_size_{0};
+    unsigned sq_local_tail_{0};
+    unsigned to_submit_{0};
+
+    // 完成队列
+    void* cq_ptr_{nullptr};
+    size_t cq_size_{0};
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe* cqes_{nullptr};
+
+    // 提供缓冲区环
+    io_uring_buf_ring* buf_ring_{nullptr};
+    size_t buf_ring_size_{0};
+    char* buf_base_{nullptr};
+    unsigned buf_tail_{0};
+    bool buf_ring_dirty_{false};
+
+    // 按需分配、不释放：vector扩容时只移动指针，已提交请求引用的Slot不会失效
+    std::vector<std::unique_ptr<Slot>> slots_;
+
+    static int sys_setup(unsigned entries, io_uring_params* p) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+    }
+
+    static int sys_enter(int fd, unsigned to_submit, unsigned min_complete,
+                         unsigned flags, void* arg, size_t argsz) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                        min_complete, flags, arg, argsz));
+    }
+
+    static int sys_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    static uint64_t make_user_data(Op op, int fd, uint32_t generation) {
+        return (static_cast<uint64_t>(generation) << 32) |
+               (static_cast<uint64_t>(fd & 0x1FFFFFFF) << 3) | op;
+    }
+
+    Slot* slot_for(int fd) {
+        if (fd < 0) return nullptr;
+        if (static_cast<size_t>(fd) >= slots_.size()) {
+            slots_.resize(fd + 1);
+        }
+        if (!slots_[fd]) {
+            slots_[fd] = std::make_unique<Slot>();
+        }
+        return slots_[fd].get();
+    }
+
+    // 只查找不创建；回调可能关闭fd或登记新fd，回调之后要重新查找
+    Slot* find_slot(int fd) const {
+        return static_cast<size_t>(fd) < slots_.size() ? slots_[fd].get() : nullptr;
+    }
+
+    bool slot_alive(int fd, uint32_t generation) const {
+        Slot* slot = find_slot(fd);
+        return slot && slot->handler && slot->generation == generation;
+    }
+
+    // 取一个空闲SQE，提交队列满时先提交已有的请求
+    io_uring_sqe* get_sqe() {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sq_local_tail_ - head >= sq_entries_) {
+            submit(0);
+            head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            if (sq_local_tail_ - head >= sq_entries_) {
+                return nullptr;
+            }
+        }
+
+        unsigned index = sq_local_tail_ & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        sq_local_tail_++;
+        to_submit_++;
+        __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+        return sqe;
+    }
+
+    // 提交请求并等待至少min_complete个完成事件
+    int submit(unsigned min_complete, int timeout_ms = -1) {
+        flush_buffers();
+
+        unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        io_uring_getevents_arg arg{};
+        __kernel_timespec ts{};
+        void* argp = nullptr;
+        size_t argsz = 0;
+
+        if (min_complete > 0 && timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+
+        int ret = sys_enter(ring_fd_, to_submit_, min_complete, flags, argp, argsz);
+        if (ret >= 0) {
+            to_submit_ -= static_cast<unsigned>(ret) < to_submit_ ? ret : to_submit_;
+        }
+        return ret;
+    }
+
+    // 把缓冲区归还给内核（只在本地记录，统一发布tail）
+    void recycle_buffer(unsigned bid) {
+        // 不用buf_ring_->bufs：C++中__DECLARE_FLEX_ARRAY的空结构体占1字节，偏移与内核不一致
+        io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(buf_ring_) + (buf_tail_ & (BUF_COUNT - 1));
+        buf->addr = reinterpret_cast<uint64_t>(buf_base_ + static_cast<size_t>(bid) * BUF_SIZE);
+        buf->len = BUF_SIZE;
+        buf->bid = static_cast<uint16_t>(bid);
+        buf_tail_++;
+        buf_ring_dirty_ = true;
+    }
+
+    void flush_buffers() {
+        if (buf_ring_dirty_) {
+            __atomic_store_n(&buf_ring_->tail, static_cast<uint16_t>(buf_tail_), __ATOMIC_RELEASE);
+            buf_ring_dirty_ = false;
+        }
+    }
+
+    // multishot accept的所有完成共用一个地址缓冲区，同一批完成事件里只有最后一个地址有效，
+    // 所以这里用单次accept，在完成后立即重新提交
+    bool arm_accept(int fd, uint32_t generation) {
+        Slot* slot = slot_for(fd);
+        io_uring_sqe* sqe = get_sqe();
+        if (!sqe) return false;
+        slot->accept_len = sizeof(slot->accept_addr);
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot->accept_addr);
+        sqe->addr2 = reinterpret_cast<uint64_t>(&slot->accept_len);
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = make_user_data(OP_ACCEPT, fd, generation);
+        return true;
+    }
+
+    bool arm_recv(int fd, uint32_t generation) {
+        io_uring_sqe* sqe = get_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUF_GROUP;
+        sqe->user_data = make_user_data(OP_RECV, fd, generation);
+        return true;
+    }
+
+    bool arm_poll(int fd, uint32_t mask, uint32_t generation) {
+        io_uring_sqe* sqe = get_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = mask;
+        sqe->user_data = make_user_data(OP_POLL, fd, generation);
+        return true;
+    }
+
+    void cancel(uint64_t user_data) {
+        io_uring_sqe* sqe = get_sqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = user_data;
+        sqe->user_data = make_user_data(OP_CANCEL, 0, 0);
+    }
+
+    uint32_t events_to_poll(EventType events) {
+        uint32_t result = 0;
+        if (static_cast<int>(events) & static_cast<int>(EventType::READ)) result |= POLLIN;
+        if (static_cast<int>(events) & static_cast<int>(EventType::WRITE)) result |= POLLOUT;
+        return result;
+    }
+
+    EventType poll_to_events(int revents) {
+        int result = 0;
+        if (revents & POLLIN) result |= static_cast<int>(EventType::READ);
+        if (revents & POLLOUT) result |= static_cast<int>(EventType::WRITE);
+        if (revents & (POLLERR | POLLHUP | POLLNVAL)) result |= static_cast<int>(EventType::ERROR);
+        return static_cast<EventType>(result);
+    }
+
+    void handle_cqe(const io_uring_cqe* cqe) {
+        Op op = static_cast<Op>(cqe->user_data & 0x7);
+        int fd = static_cast<int>((cqe->user_data >> 3) & 0x1FFFFFFF);
+        uint32_t generation = static_cast<uint32_t>(cqe->user_data >> 32);
+        bool more = cqe->flags & IORING_CQE_F_MORE;
+        bool has_buffer = cqe->flags & IORING_CQE_F_BUFFER;
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+        if (op == OP_CANCEL) return;
+
+        if (op == OP_SEND) {
+            // 发送的数据在完成前必须有效，所以fd删除后也要通知发送方释放缓冲区
+            // user_data里放不下fd，用处理器自己的fd查登记表，仍登记着该处理器才是原来的fd
+            EventHandler* sender = reinterpret_cast<EventHandler*>(cqe->user_data & ~uint64_t(0x7));
+            int sender_fd = sender->get_fd();
+            Slot* sender_slot = find_slot(sender_fd);
+            sender->handle_send(sender_slot && sender_slot->handler == sender ? sender_fd : -1, cqe->res);
+            return;
+        }
+
+        if (!slot_alive(fd, generation)) {
+            // fd已经删除，归还缓冲区；已经接受的连接没有人接管，直接关闭
+            if (has_buffer) recycle_buffer(bid);
+            if (op == OP_ACCEPT && cqe->res >= 0) close(cqe->res);
+            return;
+        }
+
+        Slot* slot = find_slot(fd);
+        EventHandler* handler = slot->handler;
+
+        switch (op) {
+        case OP_ACCEPT:
+            if (cqe->res >= 0) {
+                // 先复制地址：回调里可能再次提交accept
+                sockaddr_in addr = slot->accept_addr;
+                handler->handle_accept(cqe->res, addr);
+            }
+            if (!quit_ && slot_alive(fd, generation)) {
+                arm_accept(fd, generation);
+            }
+            break;
+
+        case OP_RECV:
+            if (cqe->res > 0 && has_buffer) {
+                const char* data = buf_base_ + static_cast<size_t>(bid) * BUF_SIZE;
+                handler->handle_recv(fd, data, cqe->res);
+                recycle_buffer(bid);
+                // 缓冲区耗尽等原因会结束multishot，此时需要重新提交
+                if (!more && slot_alive(fd, generation)) {
+                    arm_recv(fd, generation);
+                }
+            } else if (cqe->res == -ENOBUFS) {
+                if (has_buffer) recycle_buffer(bid);
+                arm_recv(fd, generation);
+            } else {
+                if (has_buffer) recycle_buffer(bid);
+                // 0表示对端关闭，负数为错误
+                handler->handle_recv(fd, nullptr, cqe->res);
+            }
+            break;
+
+        case OP_POLL:
+            if (cqe->res >= 0) {
+                handler->handle_event(fd, poll_to_events(cqe->res));
+            }
+            if (!more && slot_alive(fd, generation)) {
+                arm_poll(fd, find_slot(fd)->poll_mask, generation);
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void destroy() {
+        if (buf_ring_) {
+            io_uring_buf_reg reg{};
+            reg.bgid = BUF_GROUP;
+            sys_register(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+            munmap(buf_ring_, buf_ring_size_);
+            buf_ring_ = nullptr;
+        }
+        delete[] buf_base_;
+        buf_base_ = nullptr;
+        if (sqes_) munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_) munmap(sq_ptr_, sq_size_);
+        sqes_ = nullptr;
+        sq_ptr_ = cq_ptr_ = nullptr;
+        if (ring_fd_ >= 0) close(ring_fd_);
+        ring_fd_ = -1;
+    }
+
+public:
+    UringLoop() {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+        ring_fd_ = sys_setup(RING_ENTRIES, &params);
+        if (ring_fd_ < 0 && errno == EINVAL) {
+            // 旧内核不支持这些优化标志
+            params = io_uring_params{};
+            ring_fd_ = sys_setup(RING_ENTRIES, &params);
+        }
+        if (ring_fd_ < 0) {
+            throw std::runtime_error(std::string("io_uring_setup失败: ") + strerror(errno));
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+            !(params.features & IORING_FEAT_EXT_ARG)) {
+            destroy();
+            throw std::runtime_error("内核io_uring版本过低");
+        }
+
+        // 映射提交队列和完成队列（共享一次映射）
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (cq_size_ > sq_size_) sq_size_ = cq_size_;
+        cq_size_ = sq_size_;
+
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = nullptr;
+            destroy();
+            throw std::runtime_error("io_uring映射失败");
+        }
+        cq_ptr_ = sq_ptr_;
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+        sq_local_tail_ = *sq_tail_;
+
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            destroy();
+            throw std::runtime_error("io_uring映射SQE失败");
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        // 注册提供缓冲区环，multishot recv从中取缓冲区
+        buf_ring_size_ = BUF_COUNT * sizeof(io_uring_buf);
+        void* ring = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) {
+            destroy();
+            throw std::runtime_error("分配缓冲区环失败");
+        }
+        buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+        buf_base_ = new char[static_cast<size_t>(BUF_COUNT) * BUF_SIZE];
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+        reg.ring_entries = BUF_COUNT;
+        reg.bgid = BUF_GROUP;
+        if (sys_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            munmap(buf_ring_, buf_ring_size_);
+            buf_ring_ = nullptr;
+            destroy();
+            throw std::runtime_error("内核不支持提供缓冲区环");
+        }
+        for (unsigned i = 0; i < BUF_COUNT; i++) {
+            recycle_buffer(i);
+        }
+        flush_buffers();
+    }
+
+    ~UringLoop() override {
+        destroy();
+    }
+
+    bool add_event(int fd, EventType events, EventHandler* handler) override {
+        Slot* slot = slot_for(fd);
+        if (!slot || slot->handler) return false;
+
+        slot->handler = handler;
+        slot->op = OP_POLL;
+        slot->poll_mask = events_to_poll(events);
+        return arm_poll(fd, slot->poll_mask, slot->generation);
+    }
+
+    bool mod_event(int fd, EventType events, EventHandler* handler) override {
+        Slot* slot = slot_for(fd);
+        if (!slot || !slot->handler) return false;
+
+        slot->handler = handler;
+        if (slot->op != OP_POLL) {
+            // 完成式的fd不需要就绪通知
+            return true;
+        }
+
+        uint32_t mask = events_to_poll(events);
+        if (mask == slot->poll_mask) return true;
+
+        cancel(make_user_data(OP_POLL, fd, slot->generation));
+        slot->generation++;
+        slot->poll_mask = mask;
+        return arm_poll(fd, mask, slot->generation);
+    }
+
+    bool del_event(int fd) override {
+        Slot* slot = slot_for(fd);
+        if (!slot || !slot->handler) return false;
+
+        // 取消常驻的multishot请求；之后的完成事件因代数不同被丢弃
+        cancel(make_user_data(slot->op, fd, slot->generation));
+        slot->handler = nullptr;
+        slot->generation++;
+
+        // SQE里记录的是fd编号，调用方随后会close(fd)，新连接可能立即复用这个编号；
+        // 必须在此之前提交，让已排队的请求（包括引用slot->msg的发送）绑定到原来的socket
+        submit(0);
+        return true;
+    }
+
+    bool completion_based() const override { return true; }
+
+    bool async_accept(int listen_fd, EventHandler* handler) override {
+        Slot* slot = slot_for(listen_fd);
+        if (!slot || slot->handler) return false;
+
+        slot->handler = handler;
+        slot->op = OP_ACCEPT;
+        return arm_accept(listen_fd, slot->generation);
+    }
+
+    bool async_recv(int fd, EventHandler* handler) override {
+        Slot* slot = slot_for(fd);
+        if (!slot || slot->handler) return false;
+
+        slot->handler = handler;
+        slot->op = OP_RECV;
+        return arm_recv(fd, slot->generation);
+    }
+
+    bool async_send(int fd, const iovec* iov, int iovcnt, EventHandler* handler) override {
+        Slot* slot = slot_for(fd);
+        if (!slot || slot->handler != handler) return false;
+
+        if (iovcnt > MAX_SEND_IOV) iovcnt = MAX_SEND_IOV;
+        memcpy(slot->iov, iov, sizeof(iovec) * iovcnt);
+        slot->msg = msghdr{};
+        slot->msg.msg_iov = slot->iov;
+        slot->msg.msg_iovlen = iovcnt;
+
+        io_uring_sqe* sqe = get_sqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot->msg);
+        sqe->len = 1;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = reinterpret_cast<uint64_t>(handler) | OP_SEND;
+        return true;
+    }
+
+    void run() override {
+        begin_run();
+
+        while (!quit_) {
+            // 提交本轮积累的所有请求，并等待完成事件
+            int ret = submit(1, wait_timeout());
+            if (ret < 0 && errno != EINTR && errno != ETIME && errno != EBUSY) {
+                break;
+            }
+            
+            process_timers();
+
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                handle_cqe(&cqes_[head & cq_mask_]);
+                head++;
+                // 回调里可能提交请求，及时释放CQ槽位
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                if (head == tail) {
+                    tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+                }
+            }
+        }
+
+        end_run();
+    }
+
+    const char* name() const override { return "uring"; }
+};
+
+#endif
@@ -0,0 +1,248 @@
+//worker_pool.h
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 有界无锁队列（Vyukov MPMC）：每个槽位带序号，生产者和消费者各自CAS推进位置
+template<typename T>
+class BoundedQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+
+public:
+    // 容量向上取整为2的幂
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        cells_.reset(new Cell[size]);
+        mask_ = size - 1;
+        for (size_t i = 0; i < size; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // 队列满时返回false，value保持不变
+    bool push(T&& value) {
+        Cell* cell;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        Cell* cell;
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似判断，只用于决定是否休眠
+    bool empty() const {
+        return enqueue_pos_.load() == dequeue_pos_.load();
+    }
+};
+
+// 无界多生产者单消费者队列（Vyukov MPSC）：push为一次exchange，不会阻塞生产者
+template<typename T>
+class MpscQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    alignas(64) std::atomic<Node*> head_;  // 生产者端
+    alignas(64) Node* tail_;               // 消费者端（哨兵节点）
+
+public:
+    MpscQueue() {
+        Node* stub = new Node();
+        head_.store(stub);
+        tail_ = stub;
+    }
+
+    ~MpscQueue() {
+        Node* node = tail_;
+        while (node) {
+            Node* next = node->next.load();
+            delete node;
+            node = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 只能由单个消费者调用
+    bool pop(T& value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        tail_ = next;
+        delete tail;
+        return true;
+    }
+};
+
+// 固定大小的工作线程池：每个线程一个无锁队列，任务按key分配到线程，
+// 同一key的任务在同一线程上按提交顺序执行
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    static const int SPIN_COUNT = 64;  // 队列为空时休眠前的自旋次数
+
+    struct Worker {
+        BoundedQueue<Task> queue;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<bool> sleeping{false};
+
+        explicit Worker(size_t capacity) : queue(capacity) {}
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stopping_{false};
+
+    void worker_loop(Worker* worker) {
+        Task task;
+        int idle = 0;
+
+        while (true) {
+            if (worker->queue.pop(task)) {
+                task();
+                task = nullptr;
+                idle = 0;
+                continue;
+            }
+            if (stopping_) {
+                break;
+            }
+            if (++idle < SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // 先声明要休眠再检查队列，和submit中先入队再检查sleeping配对，不会丢失唤醒
+            std::unique_lock<std::mutex> lock(worker->mutex);
+            worker->sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            worker->cv.wait(lock, [&]() { return !worker->queue.empty() || stopping_; });
+            worker->sleeping.store(false);
+            idle = 0;
+        }
+    }
+
+public:
+    explicit WorkerPool(int threads, size_t queue_capacity = 4096) {
+        if (threads < 1) threads = 1;
+        for (int i = 0; i < threads; i++) {
+            workers_.push_back(std::make_unique<Worker>(queue_capacity));
+        }
+        for (auto& worker : workers_) {
+            Worker* w = worker.get();
+            w->thread = std::thread([this, w]() { worker_loop(w); });
+        }
+    }
+
+    ~WorkerPool() {
+        stop();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // 提交任务；目标线程的队列满时返回false，task保持不变，由提交方暂停接收请求形成背压。
+    // 不在这里等待：提交方通常是事件循环线程，等待会让它上面的所有连接停顿
+    bool try_submit(uint64_t key, Task&& task) {
+        Worker* worker = workers_[key % workers_.size()].get();
+        if (!worker->queue.push(std::move(task))) {
+            return false;
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (worker->sleeping.load()) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->cv.notify_one();
+        }
+        return true;
+    }
+
+    // 执行完已提交的任务后退出所有线程
+    void stop() {
+        if (stopping_.exchange(true)) {
+            return;
+        }
+        for (auto& worker : workers_) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->cv.notify_one();
+        }
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    size_t size() const { return workers_.size(); }
+};
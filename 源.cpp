@@ -15,6 +15,8 @@
 
 #include "network.h"
 #include "client.h"
+#include "bench.h"
+#include "resp.h"
 #include <iostream>
 #include <cstring>
 #include <csignal>
@@ -69,19 +71,49 @@
 
 // 全局变量用于信号处理
 std::atomic<bool> running{true};
+NetworkServer* g_server = nullptr;
+MultiReactorServer* g_multi_server = nullptr;
 
+// 信号处理函数中只能做异步信号安全的操作：EventLoop::stop()只写原子变量和eventfd，
+// 事件循环被唤醒后退出，其余清理在main中完成
 void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
-        std::cout << "\n收到停止信号，正在关闭服务器..." << std::endl;
+        const char msg[] = "\n收到停止信号，正在关闭服务器...\n";
+        ssize_t ret = write(STDOUT_FILENO, msg, sizeof(msg) - 1);
+        (void)ret;
         running = false;
+        if (g_server) {
+            g_server->event_loop_->stop();
+        }
+        if (g_multi_server) {
+            g_multi_server->stop();
+        }
     }
 }
 
+// 哈希表扩容后的旧桶搬迁和下一次扩容数组的缺页由事件循环每毫秒推进一批，尽量不落在请求上
+const int REHASH_INTERVAL_MS = 1;
+
+void schedule_rehash(EventLoop* loop) {
+    loop->run_every(REHASH_INTERVAL_MS, []() {
+        global_storage_engine.rehash(IntrusiveHashTable::IDLE_REHASH_STEP);
+    });
+}
+
 int main(int argc, char* argv[]) {
     // 解析命令行参数
     std::string event_loop_type = "poll";  // 默认使用poll
     std::string host = "0.0.0.0";          // 默认监听所有接口
     int port = 8899;
+    int threads = 1;                       // 1为单事件循环，>1启用多reactor
+    ServerOptions options;
+    bool use_coro = false;                 // 以协程会话处理连接
+    std::string protocol = "text";         // text或resp
+    LogLevel log_level = LogLevel::INFO;
+    std::string log_file;                  // 为空时日志写到标准输出
+
+    // 日志由后台线程写出，先启动以便基准和测试中的日志也能输出
+    Logger::instance().start();
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
@@ -93,62 +125,232 @@ int main(int argc, char* argv[]) {
         else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
             port = std::stoi(argv[++i]);
         }
+        else if (strcmp(argv[i], "--protocol") == 0 && i + 1 < argc) {
+            protocol = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            options.worker_threads = std::stoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--backlog") == 0 && i + 1 < argc) {
+            options.backlog = std::stoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--nodelay") == 0) {
+            options.tcp_nodelay = true;
+        }
+        else if (strcmp(argv[i], "--defer-accept") == 0 && i + 1 < argc) {
+            options.defer_accept_sec = std::stoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--busy-poll") == 0 && i + 1 < argc) {
+            options.busy_poll_us = std::stoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--so-busy-poll") == 0 && i + 1 < argc) {
+            options.so_busy_poll_us = std::stoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--idle-timeout") == 0 && i + 1 < argc) {
+            options.idle_timeout_ms = std::stoi(argv[++i]) * 1000;
+        }
+        else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            if (!Logger::parse_level(argv[++i], log_level)) {
+                std::cerr << "错误: 不支持的日志级别 '" << argv[i]
+                    << "'，请使用 'debug'、'info'、'warn'、'error' 或 'off'" << std::endl;
+                return 1;
+            }
+            Logger::set_level(log_level);
+        }
+        else if (strcmp(argv[i], "--log-file") == 0 && i + 1 < argc) {
+            log_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            options.stats_interval_ms = std::stoi(argv[++i]) * 1000;
+        }
+#ifdef HAVE_COROUTINES
+        else if (strcmp(argv[i], "--coro") == 0) {
+            use_coro = true;
+        }
+#endif
         else if (strcmp(argv[i], "--test") == 0) {
             // 运行测试
             test_storage_engine();
+            return test_timer_wheel() ? 0 : 1;
+        }
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            // 运行性能基准
+            std::string name = argv[++i];
+            if (name == "network") {
+                bench_event_loops();
+            }
+            else if (name == "workers") {
+                bench_workers();
+            }
+            else if (name == "latency") {
+                bench_busy_poll();
+            }
+            else if (name == "parser") {
+                bench_parser();
+            }
+            else if (name == "protocol") {
+                bench_protocols();
+            }
+            else if (name == "mget") {
+                bench_get_many();
+            }
+            else if (name == "incr") {
+                bench_incr();
+            }
+            else if (name == "reply") {
+                bench_reply_format();
+            }
+            else if (name == "shards") {
+                bench_storage_scaling();
+            }
+            else if (name == "clock") {
+                bench_eviction_policy();
+            }
+            else if (name == "hash") {
+                bench_hash_tables();
+            }
+            else if (name == "rehash") {
+                bench_rehash();
+            }
+            else if (name == "keyhash") {
+                bench_key_hash();
+            }
+#ifdef HAVE_COROUTINES
+            else if (name == "coro") {
+                bench_coro();
+            }
+#endif
+            else {
+                std::cerr << "未知的基准: " << name << std::endl;
+                return 1;
+            }
             return 0;
         }
         else if (strcmp(argv[i], "--help") == 0) {
             std::cout << "用法: " << argv[0] << " [选项]\n"
                 << "选项:\n"
-                << "  --model TYPE   事件循环模型 (poll 或 epoll，默认: poll)\n"
+                << "  --model TYPE   事件循环模型 (poll、epoll、epoll-et 或 uring，默认: poll)\n"
                 << "  --host HOST    监听地址 (默认: 0.0.0.0)\n"
                 << "  --port PORT    监听端口 (默认: 8899)\n"
-                << "  --test         运行存储引擎测试\n"
+                << "  --protocol P   连接协议: text(文本/二进制，按首字节区分) 或 resp(Redis协议) (默认: text)\n"
+                << "  --threads N    事件循环线程数，>1时每线程一个SO_REUSEPORT监听 (默认: 1)\n"
+                << "  --workers N    命令交给N个工作线程执行，事件循环只负责I/O (默认: 0，在事件循环中执行)\n"
+                << "  --backlog N    listen队列长度 (默认: SOMAXCONN)\n"
+                << "  --nodelay      对客户端连接设置TCP_NODELAY\n"
+                << "  --defer-accept SEC  设置TCP_DEFER_ACCEPT，客户端发送数据后才accept (默认: 不设置)\n"
+                << "  --busy-poll US 处理完事件后自旋US微秒再睡眠，降低延迟但多占CPU (仅epoll，默认: 0)\n"
+                << "  --so-busy-poll US  对客户端连接设置SO_BUSY_POLL (默认: 不设置)\n"
+                << "  --idle-timeout SEC  断开空闲超过SEC秒的连接，0为不断开 (默认: 300)\n"
+                << "  --stats SEC    每SEC秒输出一次连接和流量统计 (默认: 不输出)\n"
+                << "  --log-level L  日志级别: debug(含每条请求)、info、warn、error 或 off (默认: info)\n"
+                << "  --log-file F   日志追加写入文件F (默认: 标准输出)\n"
+                << "  --test         运行存储引擎和时间轮测试\n"
+#ifdef HAVE_COROUTINES
+                << "  --coro         以C++20协程会话处理连接\n"
+                << "  --bench NAME   运行性能基准 (network、workers、latency、parser、protocol、mget、incr、reply、shards、clock、hash、rehash、keyhash、coro)\n"
+#else
+                << "  --bench NAME   运行性能基准 (network、workers、latency、parser、protocol、mget、incr、reply、shards、clock、hash、rehash、keyhash)\n"
+#endif
                 << "  --help         显示帮助信息\n"
                 << "\n示例:\n"
                 << "  " << argv[0] << " --model poll --port 8899\n"
                 << "  " << argv[0] << " --model epoll --host 127.0.0.1 --port 8899\n"
+                << "  " << argv[0] << " --model epoll --threads 4\n"
+                << "  " << argv[0] << " --model epoll --protocol resp   (redis-benchmark -p 8899 -t get,set -P 16)\n"
                 << "  " << argv[0] << " --test\n";
             return 0;
         }
     }
 
     // 检查模型类型
-    if (event_loop_type != "poll" && event_loop_type != "epoll") {
+    if (event_loop_type != "poll" && event_loop_type != "epoll" &&
+        event_loop_type != "epoll-et" && event_loop_type != "uring") {
         std::cerr << "错误: 不支持的事件模型 '" << event_loop_type
-            << "'，请使用 'poll' 或 'epoll'" << std::endl;
+            << "'，请使用 'poll'、'epoll'、'epoll-et' 或 'uring'" << std::endl;
+        return 1;
+    }
+
+    if (protocol != "text" && protocol != "resp") {
+        std::cerr << "错误: 不支持的协议 '" << protocol
+            << "'，请使用 'text' 或 'resp'" << std::endl;
+        return 1;
+    }
+
+    if (!log_file.empty() && !Logger::instance().start(log_file)) {
+        std::cerr << "错误: 无法打开日志文件 '" << log_file << "'" << std::endl;
         return 1;
     }
 
     // 注册信号处理
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    // 对端关闭后继续写socket会产生SIGPIPE，默认行为是终止进程
+    signal(SIGPIPE, SIG_IGN);
 
     try {
         std::cout << "启动用户信息存储服务器..." << std::endl;
         std::cout << "模型: " << event_loop_type << std::endl;
         std::cout << "地址: " << host << std::endl;
         std::cout << "端口: " << port << std::endl;
+        std::cout << "线程: " << threads << std::endl;
+        std::cout << "工作线程: " << options.worker_threads << std::endl;
+        std::cout << "协议: " << protocol << std::endl;
+        std::cout << "日志: " << (log_file.empty() ? "标准输出" : log_file) << std::endl;
         std::cout << "存储引擎: 哈希表容量=1024, LRU容量=100" << std::endl;
 
         // 初始化一些测试数据
         test_storage_engine();
 
+        // 按协议创建连接处理器
+        MultiReactorServer::HandlerFactory make_handler =
+            [protocol, use_coro](NetworkServer* s) -> std::unique_ptr<ConnectionHandler> {
+                if (protocol == "resp") {
+                    return std::make_unique<RespHandler>(s, global_storage_engine);
+                }
+#ifdef HAVE_COROUTINES
+                if (use_coro) {
+                    return std::make_unique<CoroCommandHandler>(s, global_storage_engine);
+                }
+#endif
+                return std::make_unique<CommandHandler>(s, global_storage_engine);
+            };
+
+        if (threads > 1) {
+            // 多reactor：每个线程独立的事件循环、监听socket和命令处理器
+            MultiReactorServer server(event_loop_type, threads, make_handler, options);
+
+            if (!server.start(host, port)) {
+                std::cerr << "启动服务器失败" << std::endl;
+                return 1;
+            }
+
+            // 存储引擎是共享的，由第一个reactor负责搬迁
+            schedule_rehash(server.event_loop(0));
+
+            std::cout << "服务器已启动(" << server.size() << "个reactor)，按Ctrl+C停止..." << std::endl;
+            g_multi_server = &server;
+            server.run();
+            g_multi_server = nullptr;
+
+            std::cout << "服务器已停止" << std::endl;
+            return 0;
+        }
+
         // 创建事件循环
         auto loop = EventLoop::create(event_loop_type);
 
-        // 创建命令处理器
-        auto handler = std::make_unique<CommandHandler>(nullptr, global_storage_engine);
-
         // 创建服务器
         auto server = std::make_unique<NetworkServer>(
             std::move(loop),
-            std::move(handler)
+            nullptr,
+            options
         );
 
-        // 设置处理器中的服务器指针
-        static_cast<CommandHandler*>(server->conn_handler_.get())->set_server(server.get());
+        // 创建连接处理器，处理器需要服务器指针
+        server->set_handler(make_handler(server.get()));
 
         // 启动服务器
         if (!server->start(host, port)) {
@@ -156,11 +358,15 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
+        schedule_rehash(server->event_loop_.get());
+
         std::cout << "服务器已启动，按Ctrl+C停止..." << std::endl;
         std::cout << "等待客户端连接..." << std::endl;
 
         // 运行服务器
+        g_server = server.get();
         server->run();
+        g_server = nullptr;
 
         std::cout << "服务器已停止" << std::endl;
 